@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "common/app_policy.h"
+
+#include "common/application_data.h"
+
+namespace common {
+
+namespace {
+
+// Indexed by AppPolicy::Privilege
+const char* kKnownPrivileges[] = {
+  "http://tizen.org/privilege/fullscreen",
+  "http://tizen.org/privilege/notification",
+  "http://tizen.org/privilege/location",
+  "http://tizen.org/privilege/unlimitedstorage",
+  "http://tizen.org/privilege/mediacapture"
+};
+
+const char* kFullscreenFeature = "fullscreen";
+const char* kVisibilitySuspendFeature = "visibility,suspend";
+const char* kMediastreamRecordFeature = "mediastream,record";
+const char* kEncryptedDatabaseFeature = "encrypted,database";
+const char* kRotationLockFeature = "rotation,lock";
+const char* kBackgroundMusicFeature = "background,music";
+const char* kSoundModeFeature = "sound,mode";
+const char* kBackgroundVibrationFeature = "background,vibration";
+const char* kCSPFeature = "csp";
+
+const char* kDefaultCSPRule =
+    "default-src *; script-src 'self'; style-src 'self'; object-src 'none';";
+
+}  // namespace
+
+AppPolicy::AppPolicy(const ApplicationData* app_data)
+    : background_support_enabled_(false),
+      background_vibration_(false),
+      exclusive_sound_mode_(false),
+      hwkey_enabled_(true),
+      backbutton_presence_(false),
+      context_menu_enabled_(true),
+      encryption_enabled_(false),
+      screen_orientation_(ScreenOrientation::AUTO),
+      security_model_version_(1) {
+  // privileges
+  auto permissions = app_data->permissions_info();
+  if (permissions != NULL) {
+    const auto& api_permissions = permissions->GetAPIPermissions();
+    api_permissions_.insert(api_permissions.begin(), api_permissions.end());
+  }
+  for (size_t i = 0; i < privileges_.size(); ++i) {
+    privileges_[i] = HasPrivilege(kKnownPrivileges[i]);
+  }
+
+  // settings
+  auto setting = app_data->setting_info();
+  if (setting != NULL) {
+    background_support_enabled_ = setting->background_support_enabled();
+    background_vibration_ = setting->background_vibration();
+    exclusive_sound_mode_ =
+        setting->sound_mode() == wgt::parse::SettingInfo::SoundMode::EXCLUSIVE;
+    hwkey_enabled_ = setting->hwkey_enabled();
+    backbutton_presence_ = setting->backbutton_presence();
+    context_menu_enabled_ = setting->context_menu_enabled();
+    encryption_enabled_ = setting->encryption_enabled();
+    screen_orientation_ = setting->screen_orientation();
+  }
+
+  // security model
+  if (app_data->csp_info() != NULL || app_data->csp_report_info() != NULL ||
+      app_data->allowed_navigation_info() != NULL) {
+    security_model_version_ = 2;
+    if (app_data->csp_info() == NULL ||
+        app_data->csp_info()->security_rules().empty()) {
+      csp_rule_ = kDefaultCSPRule;
+    } else {
+      csp_rule_ = app_data->csp_info()->security_rules();
+    }
+    if (app_data->csp_report_info() != NULL &&
+        !app_data->csp_report_info()->security_rules().empty()) {
+      csp_report_rule_ = app_data->csp_report_info()->security_rules();
+    }
+  }
+
+  // extensible api features
+  if (HasPrivilege(Privilege::FULLSCREEN)) {
+    extensible_api_features_.push_back(kFullscreenFeature);
+  }
+  if (background_support_enabled_) {
+    extensible_api_features_.push_back(kVisibilitySuspendFeature);
+    extensible_api_features_.push_back(kBackgroundMusicFeature);
+  }
+  extensible_api_features_.push_back(kMediastreamRecordFeature);
+  extensible_api_features_.push_back(kEncryptedDatabaseFeature);
+  if (screen_orientation_ == ScreenOrientation::AUTO) {
+    extensible_api_features_.push_back(kRotationLockFeature);
+  }
+  if (exclusive_sound_mode_) {
+    extensible_api_features_.push_back(kSoundModeFeature);
+  }
+  if (background_vibration_) {
+    extensible_api_features_.push_back(kBackgroundVibrationFeature);
+  }
+  if (security_model_version_ == 2) {
+    extensible_api_features_.push_back(kCSPFeature);
+  }
+}
+
+AppPolicy::~AppPolicy() {
+}
+
+}  // namespace common
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef XWALK_COMMON_APP_POLICY_H_
+#define XWALK_COMMON_APP_POLICY_H_
+
+#include <wgt_manifest_handlers/setting_handler.h>
+
+#include <bitset>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace common {
+
+class ApplicationData;
+
+// Policy facts of an application which are evaluated once from the manifest
+// data. The object is immutable after construction, so the permission and
+// feature checks of the browser and the renderer don't need to walk the
+// manifest data again.
+class AppPolicy {
+ public:
+  enum class Privilege {
+    FULLSCREEN,
+    NOTIFICATION,
+    LOCATION,
+    UNLIMITED_STORAGE,
+    MEDIA_CAPTURE,
+    COUNT
+  };
+
+  typedef wgt::parse::SettingInfo::ScreenOrientation ScreenOrientation;
+
+  explicit AppPolicy(const ApplicationData* app_data);
+  ~AppPolicy();
+
+  bool HasPrivilege(Privilege privilege) const {
+    return privileges_.test(static_cast<size_t>(privilege));
+  }
+  bool HasPrivilege(const std::string& privilege) const {
+    return api_permissions_.find(privilege) != api_permissions_.end();
+  }
+
+  bool background_support_enabled() const {
+    return background_support_enabled_;
+  }
+  bool background_vibration() const { return background_vibration_; }
+  bool exclusive_sound_mode() const { return exclusive_sound_mode_; }
+  bool hwkey_enabled() const { return hwkey_enabled_; }
+  bool backbutton_presence() const { return backbutton_presence_; }
+  bool context_menu_enabled() const { return context_menu_enabled_; }
+  bool encryption_enabled() const { return encryption_enabled_; }
+  ScreenOrientation screen_orientation() const { return screen_orientation_; }
+
+  int security_model_version() const { return security_model_version_; }
+  const std::string& csp_rule() const { return csp_rule_; }
+  const std::string& csp_report_rule() const { return csp_report_rule_; }
+
+  // Tizen extensible API features that should be enabled for the app.
+  const std::vector<std::string>& extensible_api_features() const {
+    return extensible_api_features_;
+  }
+
+ private:
+  std::bitset<static_cast<size_t>(Privilege::COUNT)> privileges_;
+  std::unordered_set<std::string> api_permissions_;
+
+  bool background_support_enabled_;
+  bool background_vibration_;
+  bool exclusive_sound_mode_;
+  bool hwkey_enabled_;
+  bool backbutton_presence_;
+  bool context_menu_enabled_;
+  bool encryption_enabled_;
+  ScreenOrientation screen_orientation_;
+
+  int security_model_version_;
+  std::string csp_rule_;
+  std::string csp_report_rule_;
+
+  std::vector<std::string> extensible_api_features_;
+};
+
+}  // namespace common
+
+#endif  // XWALK_COMMON_APP_POLICY_H_
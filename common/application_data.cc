@@ -22,6 +22,7 @@
 
 #include <vector>
 
+#include "common/app_policy.h"
 #include "common/file_utils.h"
 #include "common/logger.h"
 #include "common/profiler.h"
@@ -148,6 +149,11 @@ std::shared_ptr<const wgt::parse::CSPInfo>
   return csp_report_info_;
 }
 
+std::shared_ptr<const AppPolicy>
+    ApplicationData::policy() const {
+  return policy_;
+}
+
 
 bool ApplicationData::LoadManifestData() {
   SCOPE_PROFILE();
@@ -239,6 +245,8 @@ bool ApplicationData::LoadManifestData() {
     setting_info_.reset(new wgt::parse::SettingInfo);
   }
 
+  policy_.reset(new AppPolicy(this));
+
   return true;
 }
 
@@ -39,6 +39,8 @@
 
 namespace common {
 
+class AppPolicy;
+
 class ApplicationData {
  public:
   explicit ApplicationData(const std::string& appid);
@@ -72,6 +74,8 @@ class ApplicationData {
     csp_info() const;
   std::shared_ptr<const wgt::parse::CSPInfo>
     csp_report_info() const;
+  std::shared_ptr<const AppPolicy>
+    policy() const;
 
   const std::string application_path() const { return application_path_; }
   const std::string pkg_id() const { return pkg_id_; }
@@ -104,6 +108,8 @@ class ApplicationData {
     csp_info_;
   std::shared_ptr<const wgt::parse::CSPInfo>
     csp_report_info_;
+  std::shared_ptr<const AppPolicy>
+    policy_;
 
   std::string application_path_;
   std::string pkg_id_;
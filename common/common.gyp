@@ -9,10 +9,14 @@
       'sources': [
         'command_line.h',
         'command_line.cc',
+        'constants.h',
+        'constants.cc',
         'dbus_client.h',
         'dbus_client.cc',
         'dbus_server.h',
         'dbus_server.cc',
+        'dbus_payload.h',
+        'dbus_payload.cc',
         'file_utils.h',
         'file_utils.cc',
         'string_utils.h',
@@ -28,6 +32,8 @@
         'app_db.h',
         'app_db.cc',
         'app_db_sqlite.h',
+        'app_policy.h',
+        'app_policy.cc',
         'application_data.h',
         'application_data.cc',
         'locale_manager.h',
@@ -47,6 +53,7 @@
           'capi-system-system-settings',
           'dlog',
           'gio-2.0',
+          'gio-unix-2.0',
           'uuid',
           'libwebappenc',
           'manifest-parser',
@@ -63,6 +70,7 @@
           'packages': [
             'dlog',
             'gio-2.0',
+            'gio-unix-2.0',
           ],
         },
       },
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "common/constants.h"
+
+namespace common {
+
+const char kAppDBRuntimeSection[] = "Runtime";
+const char kAppDBRuntimeAppID[] = "app_id";
+const char kAppDBRuntimeName[] = "runtime_name";
+const char kAppDBRuntimeBundle[] = "encoded_bundle";
+
+const char kRuntimeName[] = "xwalk-tizen";
+
+// If set in the environment, the runtime variables are also written to the
+// AppDB, and the extensions read the ones they don't have from it.
+const char kRuntimeVariableAppDBEnableKey[] =
+    "WRT_RUNTIME_VARIABLE_APPDB_ENABLE";
+
+}  // namespace common
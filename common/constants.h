@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef XWALK_COMMON_CONSTANTS_H_
+#define XWALK_COMMON_CONSTANTS_H_
+
+namespace common {
+
+// The runtime variables which the extensions read by
+// XW_Internal_RuntimeInterface, and the AppDB section keeping them.
+extern const char kAppDBRuntimeSection[];
+extern const char kAppDBRuntimeAppID[];
+extern const char kAppDBRuntimeName[];
+extern const char kAppDBRuntimeBundle[];
+
+// The value of the kAppDBRuntimeName variable.
+extern const char kRuntimeName[];
+
+extern const char kRuntimeVariableAppDBEnableKey[];
+
+}  // namespace common
+
+#endif  // XWALK_COMMON_CONSTANTS_H_
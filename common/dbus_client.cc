@@ -16,37 +16,125 @@
 
 #include "common/dbus_client.h"
 
+#include <gio/gunixfdlist.h>
+
+#include <mutex>
+#include <set>
+
 #include "common/file_utils.h"
 #include "common/logger.h"
 
 namespace common {
 
-namespace {
-
-void OnSignalReceived(GDBusConnection* /*connection*/,
-                      const gchar* /*sender_name*/,
-                      const gchar* /*object_path*/,
-                      const gchar* interface_name,
-                      const gchar* signal_name,
-                      GVariant* parameters,
-                      gpointer user_data) {
-  DBusClient* self = reinterpret_cast<DBusClient*>(user_data);
-  auto callback = self->GetSignalCallback(interface_name);
+struct DBusClient::FilterState {
+  explicit FilterState(DBusClient* client)
+      : client(client),
+        context(g_main_context_ref_thread_default()) {
+  }
+  ~FilterState() {
+    g_main_context_unref(context);
+  }
+
+  std::mutex mutex;
+  // NULL once the client is destroyed.
+  DBusClient* client;
+  GMainContext* context;
+  std::set<GSource*> pending_signals;
+};
+
+struct DBusClient::PendingSignal {
+  std::shared_ptr<FilterState> state;
+  GDBusMessage* message;
+};
+
+// static
+GDBusMessage* DBusClient::OnMessageFilter(GDBusConnection* /*connection*/,
+                                          GDBusMessage* message,
+                                          gboolean incoming,
+                                          gpointer user_data) {
+  if (!incoming ||
+      g_dbus_message_get_message_type(message) !=
+          G_DBUS_MESSAGE_TYPE_SIGNAL) {
+    return message;
+  }
+
+  // Runs on the GDBus worker thread. The message is owned by the filter
+  // once it is not returned.
+  std::shared_ptr<FilterState> state =
+      *static_cast<std::shared_ptr<FilterState>*>(user_data);
+  std::lock_guard<std::mutex> lock(state->mutex);
+  if (!state->client) {
+    return message;
+  }
+
+  PendingSignal* pending = new PendingSignal;
+  pending->state = state;
+  pending->message = message;
+
+  GSource* source = g_idle_source_new();
+  g_source_set_callback(source, OnDispatchSignal, pending, OnFreeSignal);
+  state->pending_signals.insert(source);
+  g_source_attach(source, state->context);
+  g_source_unref(source);
+  return NULL;
+}
+
+// static
+gboolean DBusClient::OnDispatchSignal(gpointer user_data) {
+  PendingSignal* pending = static_cast<PendingSignal*>(user_data);
+  DBusClient* self = NULL;
+  {
+    std::lock_guard<std::mutex> lock(pending->state->mutex);
+    pending->state->pending_signals.erase(g_main_current_source());
+    self = pending->state->client;
+  }
+  // The client is destroyed on the thread that dispatches its signals, so
+  // it is still alive here if it was when the lock was held.
+  if (!self) {
+    return FALSE;
+  }
+
+  GDBusMessage* message = pending->message;
+  const gchar* interface_name = g_dbus_message_get_interface(message);
+  auto callback = self->GetSignalCallback(
+      interface_name ? interface_name : "");
   if (callback) {
-    callback(signal_name, parameters);
+    callback(g_dbus_message_get_member(message),
+             g_dbus_message_get_body(message),
+             g_dbus_message_get_unix_fd_list(message));
   }
+  return FALSE;
 }
 
-}  // namespace
+// static
+void DBusClient::OnFreeSignal(gpointer user_data) {
+  PendingSignal* pending = static_cast<PendingSignal*>(user_data);
+  g_object_unref(pending->message);
+  delete pending;
+}
+
+// static
+void DBusClient::OnFreeFilter(gpointer user_data) {
+  delete static_cast<std::shared_ptr<FilterState>*>(user_data);
+}
 
 DBusClient::DBusClient()
     : connection_(NULL),
-      signal_subscription_id_(0) {
+      filter_id_(0) {
 }
 
 DBusClient::~DBusClient() {
+  if (filter_state_) {
+    std::lock_guard<std::mutex> lock(filter_state_->mutex);
+    filter_state_->client = NULL;
+    for (auto it = filter_state_->pending_signals.begin();
+         it != filter_state_->pending_signals.end(); ++it) {
+      g_source_destroy(*it);
+    }
+    filter_state_->pending_signals.clear();
+  }
   if (connection_) {
-    g_dbus_connection_signal_unsubscribe(connection_, signal_subscription_id_);
+    g_dbus_connection_remove_filter(connection_, filter_id_);
     g_dbus_connection_close_sync(connection_, NULL, NULL);
   }
 }
@@ -72,9 +160,10 @@ bool DBusClient::Connect(const std::string& address) {
     return false;
   }
 
-  signal_subscription_id_ = g_dbus_connection_signal_subscribe(
-      connection_, NULL, NULL, NULL, NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
-      OnSignalReceived, this, NULL);
+  filter_state_ = std::make_shared<FilterState>(this);
+  filter_id_ = g_dbus_connection_add_filter(
+      connection_, OnMessageFilter,
+      new std::shared_ptr<FilterState>(filter_state_), OnFreeFilter);
 
   return true;
 }
@@ -82,7 +171,8 @@ bool DBusClient::Connect(const std::string& address) {
 GVariant* DBusClient::Call(const std::string& iface,
                            const std::string& method,
                            GVariant* parameters,
-                           const GVariantType* reply_type) {
+                           const GVariantType* reply_type,
+                           GUnixFDList* fd_list) {
   if (!connection_) {
     return NULL;
   }
@@ -90,18 +180,23 @@ GVariant* DBusClient::Call(const std::string& iface,
   GError *err = NULL;
   GVariant* reply = NULL;
 
+  // Empty descriptor lists are not sent at all.
+  if (fd_list && g_unix_fd_list_get_length(fd_list) == 0) {
+    fd_list = NULL;
+  }
+
   if (reply_type) {
-    reply = g_dbus_connection_call_sync(
+    reply = g_dbus_connection_call_with_unix_fd_list_sync(
         connection_, NULL, "/", iface.c_str(), method.c_str(), parameters,
-        reply_type, G_DBUS_CALL_FLAGS_NONE, -1, NULL, &err);
+        reply_type, G_DBUS_CALL_FLAGS_NONE, -1, fd_list, NULL, NULL, &err);
     if (!reply) {
       LOGGER(ERROR) << "Failed to CallSync : " << err->message;
       g_error_free(err);
     }
   } else {
-    g_dbus_connection_call(
+    g_dbus_connection_call_with_unix_fd_list(
         connection_, NULL, "/", iface.c_str(), method.c_str(), parameters,
-        NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL, NULL);
+        NULL, G_DBUS_CALL_FLAGS_NONE, -1, fd_list, NULL, NULL, NULL);
   }
 
   return reply;
@@ -22,6 +22,7 @@
 
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 
 namespace common {
@@ -29,7 +30,8 @@ namespace common {
 class DBusClient {
  public:
   typedef std::function<void(const std::string& signal,
-                             GVariant* parameters)> SignalCallback;
+                             GVariant* parameters,
+                             GUnixFDList* fd_list)> SignalCallback;
 
   DBusClient();
   virtual ~DBusClient();
@@ -37,16 +39,37 @@ class DBusClient {
   bool Connect(const std::string& address);
   bool ConnectByName(const std::string& name);
 
+  // The descriptors in |fd_list|, if any, are passed with the call.
   GVariant* Call(const std::string& iface, const std::string& method,
-                 GVariant* parameters, const GVariantType* reply_type);
+                 GVariant* parameters, const GVariantType* reply_type,
+                 GUnixFDList* fd_list = NULL);
+
+  GDBusConnection* connection() const { return connection_; }
 
   void SetSignalCallback(const std::string& iface, SignalCallback func);
   SignalCallback GetSignalCallback(const std::string& iface);
 
  private:
+  static GDBusMessage* OnMessageFilter(GDBusConnection* connection,
+                                       GDBusMessage* message,
+                                       gboolean incoming,
+                                       gpointer user_data);
+  static gboolean OnDispatchSignal(gpointer user_data);
+  static void OnFreeSignal(gpointer user_data);
+  static void OnFreeFilter(gpointer user_data);
+
   GDBusConnection* connection_;
-  guint signal_subscription_id_;
+  guint filter_id_;
   std::map<std::string, SignalCallback> signal_callbacks_;
+
+  // The signals are taken from the connection by a filter, which keeps their
+  // descriptors, and dispatched in the order of arrival on the main context
+  // of the thread that connected. The filter may still be running on the
+  // GDBus worker thread when the client is destroyed, so it and the pending
+  // signals share this state instead of using the client.
+  struct FilterState;
+  struct PendingSignal;
+  std::shared_ptr<FilterState> filter_state_;
 };
 
 }  // namespace common
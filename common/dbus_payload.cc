@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "common/dbus_payload.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gio/gunixfdlist.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "common/logger.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+namespace common {
+
+namespace {
+
+#ifdef F_ADD_SEALS
+const int kRequiredSeals = F_SEAL_SHRINK | F_SEAL_WRITE;
+#endif
+
+// Creates an anonymous shared memory file of |size| bytes. Only memfd can be
+// sealed, so there's no fallback to a plain file if the kernel lacks it.
+int CreateSharedMemory(size_t size) {
+  int fd = -1;
+#ifdef __NR_memfd_create
+  fd = syscall(__NR_memfd_create, "xwalk-dbus-payload",
+               MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#endif
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (ftruncate(fd, size) < 0) {
+    LOGGER(ERROR) << "Failed to resize shared memory : " << strerror(errno);
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Seals |fd| so that nobody can resize or write it anymore.
+bool SealSharedMemory(int fd) {
+#ifdef F_ADD_SEALS
+  if (fcntl(fd, F_ADD_SEALS, kRequiredSeals | F_SEAL_GROW | F_SEAL_SEAL) == 0)
+    return true;
+  LOGGER(WARN) << "Failed to seal shared memory : " << strerror(errno);
+#endif
+  return false;
+}
+
+// Checks that the sender can't change |fd| while it's mapped.
+bool IsSealed(int fd) {
+#ifdef F_GET_SEALS
+  int seals = fcntl(fd, F_GET_SEALS);
+  return seals >= 0 && (seals & kRequiredSeals) == kRequiredSeals;
+#else
+  return false;
+#endif
+}
+
+}  // namespace
+
+// static
+GVariant* DBusPayload::Pack(const void* data, size_t size,
+                            GUnixFDList* fd_list) {
+  if (fd_list && size > kInlineSize) {
+    int fd = CreateSharedMemory(size);
+    void* mem = MAP_FAILED;
+    if (fd >= 0) {
+      mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    bool sealed = false;
+    if (mem != MAP_FAILED) {
+      memcpy(mem, data, size);
+      munmap(mem, size);
+      // The receiver maps the file, so it must not change under it.
+      sealed = SealSharedMemory(fd);
+    }
+    if (sealed) {
+      GError* err = NULL;
+      gint index = g_unix_fd_list_append(fd_list, fd, &err);
+      close(fd);
+      if (index >= 0) {
+        return g_variant_new_variant(
+            g_variant_new("(ht)", index, static_cast<guint64>(size)));
+      }
+      LOGGER(ERROR) << "Failed to append descriptor : " << err->message;
+      g_error_free(err);
+    } else if (fd >= 0) {
+      close(fd);
+    }
+    // Falls back to the inline payload, an unsealed file could be changed
+    // by the sender while the receiver reads it.
+  }
+
+  return g_variant_new_variant(g_variant_new_fixed_array(
+      G_VARIANT_TYPE_BYTE, data, size, sizeof(guchar)));
+}
+
+// static
+bool DBusPayload::Unpack(GVariant* payload, GUnixFDList* fd_list,
+                         Consumer consumer) {
+  GVariant* value = g_variant_get_variant(payload);
+  bool ret = false;
+
+  if (g_variant_is_of_type(value, G_VARIANT_TYPE_BYTESTRING)) {
+    gsize size = 0;
+    const void* data =
+        g_variant_get_fixed_array(value, &size, sizeof(guchar));
+    consumer(data, size);
+    ret = true;
+  } else if (g_variant_is_of_type(value, G_VARIANT_TYPE("(ht)")) && fd_list) {
+    gint32 index;
+    guint64 size;
+    g_variant_get(value, "(ht)", &index, &size);
+
+    GError* err = NULL;
+    int fd = g_unix_fd_list_get(fd_list, index, &err);
+    if (fd < 0) {
+      LOGGER(ERROR) << "Failed to get descriptor : " << err->message;
+      g_error_free(err);
+    } else if (!IsSealed(fd)) {
+      LOGGER(ERROR) << "Payload descriptor isn't sealed.";
+      close(fd);
+    } else {
+      struct stat st;
+      if (fstat(fd, &st) == 0 && static_cast<guint64>(st.st_size) >= size) {
+        void* mem = size > 0 ?
+            mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+        if (mem != MAP_FAILED) {
+          consumer(mem, size);
+          if (mem) {
+            munmap(mem, size);
+          }
+          ret = true;
+        }
+      }
+      close(fd);
+    }
+  }
+
+  if (!ret) {
+    LOGGER(ERROR) << "Malformed payload.";
+  }
+  g_variant_unref(value);
+  return ret;
+}
+
+// static
+GUnixFDList* DBusPayload::NewFDList(GDBusConnection* connection) {
+  if (!connection ||
+      !(g_dbus_connection_get_capabilities(connection) &
+        G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING)) {
+    return NULL;
+  }
+  return g_unix_fd_list_new();
+}
+
+}  // namespace common
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef XWALK_COMMON_DBUS_PAYLOAD_H_
+#define XWALK_COMMON_DBUS_PAYLOAD_H_
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include <functional>
+
+namespace common {
+
+// Byte payloads of D-Bus messages, marshalled as a "v" argument.
+// Small payloads are inlined as "ay". Larger ones are written once to a
+// sealed memfd, and only "(ht)" (the index of the descriptor in the
+// GUnixFDList of the message, and the size) goes through GVariant, so the
+// receiver maps the data instead of copying it out of the message. The
+// receiver rejects descriptors that aren't sealed against writing and
+// shrinking, and the sender inlines the payload if it can't seal them.
+class DBusPayload {
+ public:
+  typedef std::function<void(const void* data, size_t size)> Consumer;
+
+  // Payloads up to this size are always inlined.
+  static const size_t kInlineSize = 32 * 1024;
+
+  // Returns a floating "v" variant. The descriptor is appended to |fd_list|
+  // if the payload is large. If |fd_list| is NULL, the payload is inlined.
+  static GVariant* Pack(const void* data, size_t size, GUnixFDList* fd_list);
+
+  // Passes the data of |payload| to |consumer|. The data is valid only
+  // during the call. Returns false if the payload is malformed.
+  static bool Unpack(GVariant* payload, GUnixFDList* fd_list,
+                     Consumer consumer);
+
+  // Returns a new descriptor list if |connection| can pass descriptors,
+  // otherwise NULL.
+  static GUnixFDList* NewFDList(GDBusConnection* connection);
+};
+
+}  // namespace common
+
+#endif  // XWALK_COMMON_DBUS_PAYLOAD_H_
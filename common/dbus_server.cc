@@ -16,6 +16,8 @@
 
 #include "common/dbus_server.h"
 
+#include <gio/gunixfdlist.h>
+
 #include "common/logger.h"
 #include "common/file_utils.h"
 
@@ -134,6 +136,7 @@ static gboolean OnClientRequest(GDBusServer* /*dbus_server*/,
         g_dbus_connection_get_peer_credentials(connection))) {
       LOGGER(WARN) << "Invalid peer credentials.";
       g_dbus_connection_close_sync(connection, NULL, NULL);
+      return TRUE;
     }
 
     GDBusNodeInfo* node_info = self->GetIntrospectionNodeInfo();
@@ -232,12 +235,25 @@ void DBusServer::SetIntrospectionXML(const std::string& xml) {
 void DBusServer::SendSignal(GDBusConnection* connection,
                             const std::string& iface,
                             const std::string& signal_name,
-                            GVariant* parameters) {
+                            GVariant* parameters,
+                            GUnixFDList* fd_list) {
   GError* err = NULL;
-  gboolean ret = g_dbus_connection_emit_signal(
-      connection, NULL, "/",
-      iface.c_str(), signal_name.c_str(),
-      parameters, &err);
+  gboolean ret;
+  if (fd_list && g_unix_fd_list_get_length(fd_list) > 0) {
+    // g_dbus_connection_emit_signal() can't carry descriptors.
+    GDBusMessage* message = g_dbus_message_new_signal(
+        "/", iface.c_str(), signal_name.c_str());
+    g_dbus_message_set_body(message, parameters);
+    g_dbus_message_set_unix_fd_list(message, fd_list);
+    ret = g_dbus_connection_send_message(
+        connection, message, G_DBUS_SEND_MESSAGE_FLAGS_NONE, NULL, &err);
+    g_object_unref(message);
+  } else {
+    ret = g_dbus_connection_emit_signal(
+        connection, NULL, "/",
+        iface.c_str(), signal_name.c_str(),
+        parameters, &err);
+  }
   if (!ret) {
     LOGGER(ERROR) << "Failed to emit signal : '"
                   << iface << '.' << signal_name << "'";
@@ -49,9 +49,10 @@ class DBusServer {
   void SetIntrospectionXML(const std::string& xml);
   GDBusNodeInfo* GetIntrospectionNodeInfo() const { return node_info_; }
 
+  // The descriptors in |fd_list|, if any, are passed with the signal.
   void SendSignal(GDBusConnection* connection,
                   const std::string& iface, const std::string& signal_name,
-                  GVariant* parameters);
+                  GVariant* parameters, GUnixFDList* fd_list = NULL);
 
   void SetDisconnectedCallback(DisconnectedCallback func);
   void SetPeerCredentialsCallback(PeerCredentialsCallback func);
@@ -16,8 +16,12 @@
 
 #include "common/file_utils.h"
 
+#include <errno.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <libgen.h>
+#include <pwd.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #include <algorithm>
@@ -75,5 +79,44 @@ std::string GetUserRuntimeDir() {
   return path;
 }
 
+namespace {
+
+// Creates |path| if it doesn't exist, and checks that it is a directory
+// owned by the user, which others can't write in when |private_dir|.
+bool EnsureUserDir(const std::string& path, bool private_dir) {
+  if (mkdir(path.c_str(), 0700) != 0 && errno != EEXIST)
+    return false;
+  struct stat st;
+  if (lstat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) ||
+      st.st_uid != getuid())
+    return false;
+  if (private_dir)
+    return (st.st_mode & 0777) == 0700;
+  return (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+}  // namespace
+
+std::string GetUserCacheDir(const std::string& name) {
+  std::string cache_dir;
+  const char* xdg_cache_home = getenv("XDG_CACHE_HOME");
+  if (xdg_cache_home != NULL && xdg_cache_home[0] == '/') {
+    cache_dir = xdg_cache_home;
+  } else {
+    struct passwd pwd;
+    struct passwd* result = NULL;
+    char buffer[1024];
+    if (getpwuid_r(getuid(), &pwd, buffer, sizeof(buffer), &result) != 0 ||
+        result == NULL || result->pw_dir == NULL)
+      return std::string();
+    cache_dir = std::string(result->pw_dir) + "/.cache";
+  }
+
+  std::string path = cache_dir + "/" + name;
+  if (!EnsureUserDir(cache_dir, false) || !EnsureUserDir(path, true))
+    return std::string();
+  return path;
+}
+
 }  // namespace utils
 }  // namespace common
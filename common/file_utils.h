@@ -34,6 +34,11 @@ std::string ExtName(const std::string& path);
 
 std::string GetUserRuntimeDir();
 
+// Returns the directory |name| in the persistent cache directory of the user,
+// $XDG_CACHE_HOME or ~/.cache, and creates it if needed. Returns an empty
+// string unless the directory is owned by the user and private to the user.
+std::string GetUserCacheDir(const std::string& name);
+
 }  // namespace utils
 }  // namespace common
 
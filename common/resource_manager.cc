@@ -32,6 +32,7 @@
 
 #include "common/application_data.h"
 #include "common/app_control.h"
+#include "common/app_policy.h"
 #include "common/file_utils.h"
 #include "common/locale_manager.h"
 #include "common/logger.h"
@@ -187,13 +188,9 @@ ResourceManager::ResourceManager(ApplicationData* application_data,
       security_model_version_(0) {
   if (application_data != NULL) {
     appid_ = application_data->tizen_application_info()->id();
-    if (application_data->csp_info() != NULL ||
-        application_data->csp_report_info() != NULL ||
-        application_data->allowed_navigation_info() != NULL) {
-      security_model_version_ = 2;
-    } else {
-      security_model_version_ = 1;
-    }
+    policy_ = application_data->policy();
+    security_model_version_ =
+        policy_ != NULL ? policy_->security_model_version() : 1;
   }
 }
 
@@ -557,11 +554,10 @@ bool ResourceManager::CheckAllowNavigation(const std::string& url) {
 }
 
 bool ResourceManager::IsEncrypted(const std::string& path) {
-  auto setting = application_data_->setting_info();
-  if (setting.get() == NULL)
+  if (policy_ == NULL)
     return false;
 
-  if (setting->encryption_enabled()) {
+  if (policy_->encryption_enabled()) {
     std::string ext = utils::ExtName(path);
     if (kEncryptedFileExtensions.count(ext) > 0) {
       return true;
@@ -30,6 +30,7 @@ class AppControlInfo;
 namespace common {
 
 class ApplicationData;
+class AppPolicy;
 class LocaleManager;
 class AppControl;
 
@@ -98,6 +99,7 @@ class ResourceManager {
   std::map<const std::string, bool> warp_cache_;
 
   ApplicationData* application_data_;
+  std::shared_ptr<const AppPolicy> policy_;
   LocaleManager* locale_manager_;
   int security_model_version_;
 };
@@ -27,5 +27,14 @@ const char kMethodSendSyncMessage[] = "SendSyncMessage";
 const char kMethodPostMessage[] = "PostMessage";
 const char kSignalOnMessageToJS[] = "OnMessageToJS";
 const char kMethodGetJavascriptCode[] = "GetJavascriptCode";
+const char kMethodPostBinaryMessage[] = "PostBinaryMessage";
+const char kMethodSendAsyncMessage[] = "SendAsyncMessage";
+const char kSignalOnBinaryMessageToJS[] = "OnBinaryMessageToJS";
+const char kSignalOnAsyncReplyToJS[] = "OnAsyncReplyToJS";
+const char kMethodGetMetrics[] = "GetMetrics";
+
+// If set in the environment, the extensions run in a shared extension host
+// process instead of each renderer.
+const char kExtensionHostEnableKey[] = "WRT_EXTENSION_HOST_ENABLE";
 
 }  // namespace extensions
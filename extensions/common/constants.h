@@ -28,6 +28,13 @@ extern const char kMethodSendSyncMessage[];
 extern const char kMethodPostMessage[];
 extern const char kSignalOnMessageToJS[];
 extern const char kMethodGetJavascriptCode[];
+extern const char kMethodPostBinaryMessage[];
+extern const char kMethodSendAsyncMessage[];
+extern const char kSignalOnBinaryMessageToJS[];
+extern const char kSignalOnAsyncReplyToJS[];
+extern const char kMethodGetMetrics[];
+
+extern const char kExtensionHostEnableKey[];
 
 }  // namespace extensions
 
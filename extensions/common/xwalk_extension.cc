@@ -6,10 +6,17 @@
 #include "extensions/common/xwalk_extension.h"
 
 #include <dlfcn.h>
+#include <string.h>
+
+#include <mutex>
 #include <string>
 
 #include "common/logger.h"
+#include "common/picojson.h"
 #include "extensions/common/xwalk_extension_adapter.h"
+#include "extensions/common/xwalk_extension_metrics.h"
+#include "extensions/common/xwalk_extension_privileges.h"
+#include "extensions/common/xwalk_extension_worker.h"
 #include "extensions/public/XW_Extension.h"
 
 namespace extensions {
@@ -18,14 +25,26 @@ XWalkExtension::XWalkExtension(const std::string& path,
                                XWalkExtensionDelegate* delegate)
   : initialized_(false),
     library_path_(path),
+    library_handle_(NULL),
     xw_extension_(0),
+    instance_count_(0),
+    last_use_time_(0),
+    stats_(NULL),
     lazy_loading_(false),
+    use_worker_thread_(false),
+    unloadable_(false),
+    pool_max_size_(0),
+    pool_idle_timeout_(0),
+    pool_timer_(NULL),
     delegate_(delegate),
     created_instance_callback_(NULL),
     destroyed_instance_callback_(NULL),
     shutdown_callback_(NULL),
     handle_msg_callback_(NULL),
-    handle_sync_msg_callback_(NULL) {
+    handle_binary_msg_callback_(NULL),
+    handle_sync_msg_callback_(NULL),
+    handle_async_msg_callback_(NULL),
+    reset_instance_callback_(NULL) {
 }
 
 XWalkExtension::XWalkExtension(const std::string& path,
@@ -34,31 +53,54 @@ XWalkExtension::XWalkExtension(const std::string& path,
                                XWalkExtensionDelegate* delegate)
   : initialized_(false),
     library_path_(path),
+    library_handle_(NULL),
     xw_extension_(0),
+    instance_count_(0),
+    last_use_time_(0),
+    stats_(NULL),
     name_(name),
     entry_points_(entry_points),
     lazy_loading_(true),
+    use_worker_thread_(false),
+    unloadable_(false),
+    pool_max_size_(0),
+    pool_idle_timeout_(0),
+    pool_timer_(NULL),
     delegate_(delegate),
     created_instance_callback_(NULL),
     destroyed_instance_callback_(NULL),
     shutdown_callback_(NULL),
     handle_msg_callback_(NULL),
-    handle_sync_msg_callback_(NULL) {
+    handle_binary_msg_callback_(NULL),
+    handle_sync_msg_callback_(NULL),
+    handle_async_msg_callback_(NULL),
+    reset_instance_callback_(NULL) {
 }
 
 XWalkExtension::~XWalkExtension() {
   if (!initialized_)
     return;
 
+  ClearInstancePool();
+  Shutdown();
+}
+
+void XWalkExtension::Shutdown() {
+  // Finishes the callbacks queued to the worker before the shutdown.
+  worker_.reset();
+
   if (shutdown_callback_)
     shutdown_callback_(xw_extension_);
   XWalkExtensionAdapter::GetInstance()->UnregisterExtension(this);
 }
 
 bool XWalkExtension::Initialize() {
+  std::lock_guard<std::mutex> lock(initialize_mutex_);
   if (initialized_)
     return true;
 
+  uint64_t start_us = XWalkExtensionMetrics::enabled() ?
+      XWalkExtensionMetrics::NowMicroseconds() : 0;
   void* handle = dlopen(library_path_.c_str(), RTLD_LAZY);
   if (!handle) {
     LOGGER(ERROR) << "Error loading extension '"
@@ -83,23 +125,143 @@ bool XWalkExtension::Initialize() {
   if (ret != XW_OK) {
     LOGGER(ERROR) << "Error loading extension '" << library_path_
                   << "' : XW_Initialize() returned error value.";
+    adapter->UnregisterExtension(this);
     dlclose(handle);
     return false;
   }
 
+  if (use_worker_thread_) {
+    worker_.reset(new XWalkExtensionWorker(name_));
+  }
+
+  library_handle_ = handle;
+  last_use_time_ = ecore_time_get();
   initialized_ = true;
+
+  if (XWalkExtensionMetrics::enabled()) {
+    // The name of an extension without metadata is known only now.
+    XWalkExtensionMetrics* metrics = XWalkExtensionMetrics::GetInstance();
+    stats_ = metrics->GetStats(name_);
+    uint64_t elapsed = XWalkExtensionMetrics::NowMicroseconds() - start_us;
+    stats_->Add(&stats_->init_count, 1);
+    stats_->Add(&stats_->init_time_us, elapsed);
+    metrics->AddTraceEvent(name_, "Initialize", start_us, elapsed);
+  }
+  return true;
+}
+
+bool XWalkExtension::UnloadIfIdle(double idle_time) {
+  std::lock_guard<std::mutex> lock(initialize_mutex_);
+  // The extensions without metadata can't be registered again by name and
+  // entry points, so they are kept loaded. The others may leave callbacks
+  // into their library behind, so they are unloaded only if they opt in.
+  if (!initialized_ || !lazy_loading_ || !unloadable_ || instance_count_ > 0)
+    return false;
+  if (ecore_time_get() - last_use_time_ < idle_time)
+    return false;
+
+  Shutdown();
+
+  created_instance_callback_ = NULL;
+  destroyed_instance_callback_ = NULL;
+  shutdown_callback_ = NULL;
+  handle_msg_callback_ = NULL;
+  handle_binary_msg_callback_ = NULL;
+  handle_sync_msg_callback_ = NULL;
+  handle_async_msg_callback_ = NULL;
+  reset_instance_callback_ = NULL;
+  // The table is registered again by the next initialization.
+  api_privileges_.clear();
+
+  dlclose(library_handle_);
+  library_handle_ = NULL;
+  xw_extension_ = 0;
+  initialized_ = false;
+
+  LOGGER(DEBUG) << "Extension '" << name_ << "' is unloaded.";
   return true;
 }
 
 XWalkExtensionInstance* XWalkExtension::CreateInstance() {
   Initialize();
+  last_use_time_ = ecore_time_get();
+  if (!instance_pool_.empty()) {
+    // The most recently released instance is reused.
+    XWalkExtensionInstance* instance = instance_pool_.back().instance;
+    instance_pool_.pop_back();
+    return instance;
+  }
   XWalkExtensionAdapter* adapter = XWalkExtensionAdapter::GetInstance();
   XW_Instance xw_instance = adapter->GetNextXWInstance();
   return new XWalkExtensionInstance(this, xw_instance);
 }
 
+void XWalkExtension::ReleaseInstance(XWalkExtensionInstance* instance) {
+  last_use_time_ = ecore_time_get();
+  if (pool_max_size_ == 0 || !initialized_) {
+    delete instance;
+    return;
+  }
+
+  // The pooled instance gets a new handle, so the work still in flight for
+  // the page which released it doesn't reach the next page.
+  instance->Reset();
+  if (!XWalkExtensionAdapter::GetInstance()->RenewInstance(instance)) {
+    delete instance;
+    return;
+  }
+  PooledInstance pooled = { instance, ecore_time_get() };
+  instance_pool_.push_back(pooled);
+  while (instance_pool_.size() > pool_max_size_) {
+    delete instance_pool_.front().instance;
+    instance_pool_.pop_front();
+  }
+
+  if (!pool_timer_) {
+    pool_timer_ =
+        ecore_timer_add(pool_idle_timeout_, OnInstancePoolTimer, this);
+  }
+}
+
+// static
+Eina_Bool XWalkExtension::OnInstancePoolTimer(void* data) {
+  XWalkExtension* self = static_cast<XWalkExtension*>(data);
+  self->EvictIdleInstances();
+  if (self->instance_pool_.empty()) {
+    self->pool_timer_ = NULL;
+    return ECORE_CALLBACK_CANCEL;
+  }
+
+  // Fires again when the oldest instance expires.
+  double remaining = self->instance_pool_.front().release_time +
+                     self->pool_idle_timeout_ - ecore_time_get();
+  ecore_timer_interval_set(self->pool_timer_, remaining > 0 ? remaining : 0);
+  return ECORE_CALLBACK_RENEW;
+}
+
+void XWalkExtension::EvictIdleInstances() {
+  double now = ecore_time_get();
+  while (!instance_pool_.empty() &&
+         instance_pool_.front().release_time + pool_idle_timeout_ <= now) {
+    delete instance_pool_.front().instance;
+    instance_pool_.pop_front();
+  }
+}
+
+void XWalkExtension::ClearInstancePool() {
+  if (pool_timer_) {
+    ecore_timer_del(pool_timer_);
+    pool_timer_ = NULL;
+  }
+  for (auto it = instance_pool_.begin(); it != instance_pool_.end(); ++it) {
+    delete it->instance;
+  }
+  instance_pool_.clear();
+}
+
 std::string XWalkExtension::GetJavascriptCode() {
   Initialize();
+  last_use_time_ = ecore_time_get();
   return javascript_api_;
 }
 
@@ -109,13 +271,54 @@ void XWalkExtension::GetRuntimeVariable(const char* key, char* value,
     delegate_->GetRuntimeVariable(key, value, value_len);
   }
 }
-int XWalkExtension::CheckAPIAccessControl(const char* /*api_name*/) {
-  // Not Supported
+
+int XWalkExtension::CheckAPIAccessControl(const char* api_name) {
+  // The APIs not in the permission table need no privilege.
+  auto it = api_privileges_.find(api_name);
+  if (it == api_privileges_.end())
+    return XW_OK;
+
+  XWalkExtensionPrivileges* privileges =
+      XWalkExtensionPrivileges::GetInstance();
+  for (auto index = it->second.begin(); index != it->second.end(); ++index) {
+    if (!privileges->IsGranted(*index)) {
+      LOGGER(WARN) << "Access to '" << api_name << "' of extension '"
+                   << name_ << "' is denied.";
+      return XW_ERROR;
+    }
+  }
   return XW_OK;
 }
 
-int XWalkExtension::RegisterPermissions(const char* /*perm_table*/) {
-  // Not Supported
+int XWalkExtension::RegisterPermissions(const char* perm_table) {
+  // The table lists the APIs which each privilege guards, like
+  // [{"permission_name":"http://tizen.org/privilege/x","apis":["a","b"]}]
+  picojson::value table;
+  std::string err = picojson::parse(table, perm_table,
+                                    perm_table + strlen(perm_table));
+  if (!err.empty() || !table.is<picojson::array>()) {
+    LOGGER(ERROR) << "Invalid permission table of extension '" << name_
+                  << "' : " << err;
+    return XW_ERROR;
+  }
+
+  XWalkExtensionPrivileges* privileges =
+      XWalkExtensionPrivileges::GetInstance();
+  for (const auto& entry : table.get<picojson::array>()) {
+    const picojson::value& permission = entry.get("permission_name");
+    const picojson::value& apis = entry.get("apis");
+    if (!permission.is<std::string>() || !apis.is<picojson::array>()) {
+      LOGGER(ERROR) << "Invalid permission table of extension '" << name_
+                    << "'";
+      return XW_ERROR;
+    }
+    size_t index = privileges->GetIndex(permission.get<std::string>());
+    for (const auto& api : apis.get<picojson::array>()) {
+      if (api.is<std::string>()) {
+        api_privileges_[api.get<std::string>()].push_back(index);
+      }
+    }
+  }
   return XW_OK;
 }
 
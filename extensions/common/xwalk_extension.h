@@ -6,17 +6,27 @@
 #ifndef XWALK_EXTENSIONS_XWALK_EXTENSION_H_
 #define XWALK_EXTENSIONS_XWALK_EXTENSION_H_
 
+#include <Ecore.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "extensions/common/xwalk_extension_instance.h"
 #include "extensions/public/XW_Extension.h"
+#include "extensions/public/XW_Extension_InstancePool.h"
 #include "extensions/public/XW_Extension_SyncMessage.h"
 
 namespace extensions {
 
 class XWalkExtensionAdapter;
 class XWalkExtensionInstance;
+class XWalkExtensionWorker;
+struct XWalkExtensionStats;
 
 class XWalkExtension {
  public:
@@ -37,11 +47,26 @@ class XWalkExtension {
 
   bool Initialize();
   XWalkExtensionInstance* CreateInstance();
+  // Destroys |instance|, or keeps it in the instance pool for reuse.
+  void ReleaseInstance(XWalkExtensionInstance* instance);
   std::string GetJavascriptCode();
 
-  std::string name() const { return name_; }
+  // Shuts the extension down and closes its library if it is unloadable,
+  // has no live instances and was not used for |idle_time| seconds. It is
+  // loaded again on the next use. Returns true if the extension is unloaded.
+  bool UnloadIfIdle(double idle_time);
+  // Destroys all the pooled instances.
+  void ClearInstancePool();
+
+  // The name and the entry points may be set by XW_Initialize() on the
+  // preloading thread, so copies are returned.
+  std::string name() const {
+    std::lock_guard<std::mutex> lock(info_mutex_);
+    return name_;
+  }
 
-  const StringVector& entry_points() const {
+  StringVector entry_points() const {
+    std::lock_guard<std::mutex> lock(info_mutex_);
     return entry_points_;
   }
 
@@ -49,22 +74,79 @@ class XWalkExtension {
     return lazy_loading_;
   }
 
+  // If true, the callbacks of the extension run on a dedicated thread
+  // instead of the main thread. Must be set before Initialize().
+  void set_use_worker_thread(bool use_worker_thread) {
+    use_worker_thread_ = use_worker_thread;
+  }
+
+  // If true, the library may be closed while the extension is not used. Only
+  // extensions with metadata which declare "unloadable" opt in.
+  void set_unloadable(bool unloadable) {
+    unloadable_ = unloadable;
+  }
+
+  // Released instances are kept up to |max_size| for |idle_timeout| seconds
+  // and reused by CreateInstance(). Must be set before Initialize().
+  void set_instance_pool(size_t max_size, double idle_timeout) {
+    pool_max_size_ = max_size;
+    pool_idle_timeout_ = idle_timeout;
+  }
+
+  // Returns NULL if the extension runs on the main thread.
+  XWalkExtensionWorker* worker() const { return worker_.get(); }
+
  private:
   friend class XWalkExtensionAdapter;
   friend class XWalkExtensionInstance;
 
+  struct PooledInstance {
+    XWalkExtensionInstance* instance;
+    double release_time;
+  };
+
+  static Eina_Bool OnInstancePoolTimer(void* data);
+  void EvictIdleInstances();
+  void Shutdown();
+
   void GetRuntimeVariable(const char* key, char* value, size_t value_len);
   int CheckAPIAccessControl(const char* api_name);
   int RegisterPermissions(const char* perm_table);
 
+  // Extensions may be initialized by the preloading thread while the main
+  // thread touches them for the first time.
+  std::mutex initialize_mutex_;
   bool initialized_;
   std::string library_path_;
+  void* library_handle_;
   XW_Extension xw_extension_;
 
+  // The live instances, including the pooled ones. Touched only on the main
+  // thread.
+  size_t instance_count_;
+  // Time of the last use, as returned by ecore_time_get().
+  std::atomic<double> last_use_time_;
+  // NULL unless the extension metrics are enabled.
+  XWalkExtensionStats* stats_;
+
+  // Guards |name_| and |entry_points_|, which are written only while the
+  // extension is initialized and read from any thread.
+  mutable std::mutex info_mutex_;
   std::string name_;
   std::string javascript_api_;
   StringVector entry_points_;
+  // The indexes of the privileges required by each API. The table is
+  // registered while the extension is initialized, before it has instances.
+  std::unordered_map<std::string, std::vector<size_t>> api_privileges_;
   bool lazy_loading_;
+  bool use_worker_thread_;
+  bool unloadable_;
+  std::unique_ptr<XWalkExtensionWorker> worker_;
+
+  size_t pool_max_size_;
+  double pool_idle_timeout_;
+  std::deque<PooledInstance> instance_pool_;
+  Ecore_Timer* pool_timer_;
 
   XWalkExtensionDelegate* delegate_;
 
@@ -72,7 +154,10 @@ class XWalkExtension {
   XW_DestroyedInstanceCallback destroyed_instance_callback_;
   XW_ShutdownCallback shutdown_callback_;
   XW_HandleMessageCallback handle_msg_callback_;
+  XW_HandleBinaryMessageCallback handle_binary_msg_callback_;
   XW_HandleSyncMessageCallback handle_sync_msg_callback_;
+  XW_HandleAsyncMessageCallback handle_async_msg_callback_;
+  XW_ResetInstanceCallback reset_instance_callback_;
 };
 
 }  // namespace extensions
@@ -5,15 +5,16 @@
 
 #include "extensions/common/xwalk_extension_adapter.h"
 
+#include <algorithm>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "common/logger.h"
 
 namespace extensions {
 
-XWalkExtensionAdapter::XWalkExtensionAdapter()
-  : next_xw_extension_(1),
-    next_xw_instance_(1) {
+XWalkExtensionAdapter::XWalkExtensionAdapter() {
 }
 
 XWalkExtensionAdapter::~XWalkExtensionAdapter() {
@@ -25,53 +26,80 @@ XWalkExtensionAdapter* XWalkExtensionAdapter::GetInstance() {
 }
 
 XW_Extension XWalkExtensionAdapter::GetNextXWExtension() {
-  return next_xw_extension_++;
+  std::lock_guard<std::mutex> lock(extension_mutex_);
+  return extension_map_.Allocate();
 }
 
 XW_Instance XWalkExtensionAdapter::GetNextXWInstance() {
-  return next_xw_instance_++;
+  std::lock_guard<std::mutex> lock(instance_mutex_);
+  return instance_map_.Allocate();
 }
 
 void XWalkExtensionAdapter::RegisterExtension(XWalkExtension* extension) {
+  std::lock_guard<std::mutex> lock(extension_mutex_);
   XW_Extension xw_extension = extension->xw_extension_;
-  if (!(xw_extension > 0 && xw_extension < next_xw_extension_)) {
+  if (!extension_map_.Set(xw_extension, extension)) {
     LOGGER(WARN) << "xw_extension (" << xw_extension << ") is invalid.";
-    return;
   }
-  if (extension_map_.find(xw_extension) == extension_map_.end())
-    extension_map_[xw_extension] = extension;
 }
 
 void XWalkExtensionAdapter::UnregisterExtension(XWalkExtension* extension) {
+  std::lock_guard<std::mutex> lock(extension_mutex_);
   XW_Extension xw_extension = extension->xw_extension_;
-  if (!(xw_extension > 0 && xw_extension < next_xw_extension_)) {
+  if (extension_map_.Get(xw_extension) != extension ||
+      !extension_map_.Release(xw_extension)) {
     LOGGER(WARN) << "xw_extension (" << xw_extension << ") is invalid.";
-    return;
   }
-  if (extension_map_.find(xw_extension) != extension_map_.end())
-    extension_map_.erase(xw_extension);
 }
 
 void XWalkExtensionAdapter::RegisterInstance(
     XWalkExtensionInstance* instance) {
+  std::lock_guard<std::mutex> lock(instance_mutex_);
   XW_Instance xw_instance = instance->xw_instance_;
-  if (!(xw_instance > 0 && xw_instance < next_xw_instance_)) {
+  if (!instance_map_.Set(xw_instance, instance)) {
     LOGGER(WARN) << "xw_instance (" << xw_instance << ") is invalid.";
-    return;
   }
-  if (instance_map_.find(xw_instance) == instance_map_.end())
-    instance_map_[xw_instance] = instance;
 }
 
 void XWalkExtensionAdapter::UnregisterInstance(
     XWalkExtensionInstance* instance) {
+  std::lock_guard<std::mutex> lock(instance_mutex_);
   XW_Instance xw_instance = instance->xw_instance_;
-  if (!(xw_instance > 0 && xw_instance < next_xw_instance_)) {
+  if (instance_map_.Get(xw_instance) != instance ||
+      !instance_map_.Release(xw_instance)) {
     LOGGER(WARN) << "xw_instance (" << xw_instance << ") is invalid.";
-    return;
   }
-  if (instance_map_.find(xw_instance) != instance_map_.end())
-    instance_map_.erase(xw_instance);
+}
+
+bool XWalkExtensionAdapter::RenewInstance(XWalkExtensionInstance* instance) {
+  std::lock_guard<std::mutex> lock(instance_mutex_);
+  XW_Instance xw_instance = instance->xw_instance_;
+  if (instance_map_.Get(xw_instance) != instance ||
+      !instance_map_.Release(xw_instance)) {
+    LOGGER(WARN) << "xw_instance (" << xw_instance << ") is invalid.";
+    return false;
+  }
+  xw_instance = instance_map_.Allocate();
+  if (!instance_map_.Set(xw_instance, instance)) {
+    LOGGER(WARN) << "No xw_instance is left for a pooled instance.";
+    instance->xw_instance_ = 0;
+    return false;
+  }
+  instance->xw_instance_ = xw_instance;
+  return true;
+}
+
+void XWalkExtensionAdapter::AttachMessageLoop() {
+  if (message_queue_)
+    return;
+  main_thread_id_ = std::this_thread::get_id();
+  message_queue_.reset(new XWalkExtensionMessageQueue(DeliverMessage));
+}
+
+void XWalkExtensionAdapter::DetachMessageLoop() {
+  // The queue itself stays, as other threads may still push to it.
+  if (message_queue_)
+    message_queue_->Close();
 }
 
 const void* XWalkExtensionAdapter::GetInterface(const char* name) {
@@ -95,6 +123,16 @@ const void* XWalkExtensionAdapter::GetInterface(const char* name) {
     return &messagingInterface1;
   }
 
+  if (!strcmp(name, XW_MESSAGING_INTERFACE_2)) {
+    static const XW_MessagingInterface_2 messagingInterface2 = {
+      MessagingRegister,
+      MessagingPostMessage,
+      MessagingRegisterBinaryMessageCallback,
+      MessagingPostBinaryMessage
+    };
+    return &messagingInterface2;
+  }
+
   if (!strcmp(name, XW_INTERNAL_SYNC_MESSAGING_INTERFACE_1)) {
     static const XW_Internal_SyncMessagingInterface_1
         syncMessagingInterface1 = {
@@ -104,6 +142,21 @@ const void* XWalkExtensionAdapter::GetInterface(const char* name) {
     return &syncMessagingInterface1;
   }
 
+  if (!strcmp(name, XW_INTERNAL_ASYNC_REPLY_INTERFACE_1)) {
+    static const XW_Internal_AsyncReplyInterface_1 asyncReplyInterface1 = {
+      AsyncReplyRegister,
+      AsyncReplySetReply
+    };
+    return &asyncReplyInterface1;
+  }
+
+  if (!strcmp(name, XW_INTERNAL_INSTANCE_POOL_INTERFACE_1)) {
+    static const XW_Internal_InstancePoolInterface_1 instancePoolInterface1 = {
+      InstancePoolRegisterResetCallback
+    };
+    return &instancePoolInterface1;
+  }
+
   if (!strcmp(name, XW_INTERNAL_ENTRY_POINTS_INTERFACE_1)) {
     static const XW_Internal_EntryPointsInterface_1 entryPointsInterface1 = {
       EntryPointsSetExtraJSEntryPoints
@@ -132,19 +185,49 @@ const void* XWalkExtensionAdapter::GetInterface(const char* name) {
 
 XWalkExtension* XWalkExtensionAdapter::GetExtension(XW_Extension xw_extension) {
   XWalkExtensionAdapter* adapter = XWalkExtensionAdapter::GetInstance();
-  ExtensionMap::iterator it = adapter->extension_map_.find(xw_extension);
-  if (it == adapter->extension_map_.end())
-    return NULL;
-  return it->second;
+  std::lock_guard<std::mutex> lock(adapter->extension_mutex_);
+  return adapter->extension_map_.Get(xw_extension);
 }
 
 XWalkExtensionInstance* XWalkExtensionAdapter::GetExtensionInstance(
     XW_Instance xw_instance) {
   XWalkExtensionAdapter* adapter = XWalkExtensionAdapter::GetInstance();
-  InstanceMap::iterator it = adapter->instance_map_.find(xw_instance);
-  if (it == adapter->instance_map_.end())
-    return NULL;
-  return it->second;
+  std::lock_guard<std::mutex> lock(adapter->instance_mutex_);
+  return adapter->instance_map_.Get(xw_instance);
+}
+
+bool XWalkExtensionAdapter::PostToMainThread(
+    const XWalkExtensionMessageQueue::Message& message) {
+  XWalkExtensionAdapter* adapter = XWalkExtensionAdapter::GetInstance();
+  if (!adapter->message_queue_ ||
+      std::this_thread::get_id() == adapter->main_thread_id_)
+    return false;
+  adapter->message_queue_->Push(message);
+  return true;
+}
+
+void XWalkExtensionAdapter::DeliverMessage(
+    const XWalkExtensionMessageQueue::Message& message) {
+  // The instance may have been destroyed while the message was queued.
+  XWalkExtensionInstance* instance =
+      GetExtensionInstance(message.xw_instance);
+  if (!instance) {
+    LOGGER(DEBUG) << "Dropping a message to destroyed instance "
+                  << message.xw_instance;
+    return;
+  }
+  switch (message.type) {
+    case XWalkExtensionMessageQueue::MessageType::MESSAGE:
+      instance->PostMessageToJS(message.data);
+      break;
+    case XWalkExtensionMessageQueue::MessageType::BINARY_MESSAGE:
+      instance->PostBinaryMessageToJS(message.data.data(),
+                                      message.data.size());
+      break;
+    case XWalkExtensionMessageQueue::MessageType::ASYNC_REPLY:
+      instance->AsyncReplyToJS(message.request_id, message.data);
+      break;
+  }
 }
 
 #define CHECK(x, xw) \
@@ -163,6 +246,7 @@ void XWalkExtensionAdapter::CoreSetExtensionName(
   XWalkExtension* extension = GetExtension(xw_extension);
   CHECK(extension, xw_extension);
   RETURN_IF_INITIALIZED(extension);
+  std::lock_guard<std::mutex> lock(extension->info_mutex_);
   extension->name_ = name;
 }
 
@@ -198,14 +282,18 @@ void XWalkExtensionAdapter::CoreRegisterShutdownCallback(
 void XWalkExtensionAdapter::CoreSetInstanceData(
     XW_Instance xw_instance,
     void* data) {
-  XWalkExtensionInstance* instance = GetExtensionInstance(xw_instance);
+  XWalkExtensionAdapter* adapter = XWalkExtensionAdapter::GetInstance();
+  std::lock_guard<std::mutex> lock(adapter->instance_mutex_);
+  XWalkExtensionInstance* instance = adapter->instance_map_.Get(xw_instance);
   CHECK(instance, xw_instance);
   instance->instance_data_ = data;
 }
 
 void* XWalkExtensionAdapter::CoreGetInstanceData(
     XW_Instance xw_instance) {
-  XWalkExtensionInstance* instance = GetExtensionInstance(xw_instance);
+  XWalkExtensionAdapter* adapter = XWalkExtensionAdapter::GetInstance();
+  std::lock_guard<std::mutex> lock(adapter->instance_mutex_);
+  XWalkExtensionInstance* instance = adapter->instance_map_.Get(xw_instance);
   if (instance)
     return instance->instance_data_;
   else
@@ -224,11 +312,44 @@ void XWalkExtensionAdapter::MessagingRegister(
 void XWalkExtensionAdapter::MessagingPostMessage(
     XW_Instance xw_instance,
     const char* message) {
+  // JavaScript can be called only on the main thread, so the messages
+  // posted from other threads are delivered through the message queue.
+  XWalkExtensionMessageQueue::Message queued;
+  queued.xw_instance = xw_instance;
+  queued.data = message;
+  if (PostToMainThread(queued))
+    return;
+
   XWalkExtensionInstance* instance = GetExtensionInstance(xw_instance);
   CHECK(instance, xw_instance);
   instance->PostMessageToJS(message);
 }
 
+void XWalkExtensionAdapter::MessagingRegisterBinaryMessageCallback(
+    XW_Extension xw_extension,
+    XW_HandleBinaryMessageCallback handle_binary_message) {
+  XWalkExtension* extension = GetExtension(xw_extension);
+  CHECK(extension, xw_extension);
+  RETURN_IF_INITIALIZED(extension);
+  extension->handle_binary_msg_callback_ = handle_binary_message;
+}
+
+void XWalkExtensionAdapter::MessagingPostBinaryMessage(
+    XW_Instance xw_instance,
+    const void* data,
+    size_t size) {
+  XWalkExtensionMessageQueue::Message queued;
+  queued.xw_instance = xw_instance;
+  queued.type = XWalkExtensionMessageQueue::MessageType::BINARY_MESSAGE;
+  queued.data.assign(static_cast<const char*>(data), size);
+  if (PostToMainThread(queued))
+    return;
+
+  XWalkExtensionInstance* instance = GetExtensionInstance(xw_instance);
+  CHECK(instance, xw_instance);
+  instance->PostBinaryMessageToJS(data, size);
+}
+
 void XWalkExtensionAdapter::SyncMessagingRegister(
     XW_Extension xw_extension,
     XW_HandleSyncMessageCallback handle_sync_message) {
@@ -246,6 +367,41 @@ void XWalkExtensionAdapter::SyncMessagingSetSyncReply(
   instance->SyncReplyToJS(reply);
 }
 
+void XWalkExtensionAdapter::AsyncReplyRegister(
+    XW_Extension xw_extension,
+    XW_HandleAsyncMessageCallback handle_async_message) {
+  XWalkExtension* extension = GetExtension(xw_extension);
+  CHECK(extension, xw_extension);
+  RETURN_IF_INITIALIZED(extension);
+  extension->handle_async_msg_callback_ = handle_async_message;
+}
+
+void XWalkExtensionAdapter::AsyncReplySetReply(
+    XW_Instance xw_instance,
+    int32_t request_id,
+    const char* reply) {
+  XWalkExtensionMessageQueue::Message queued;
+  queued.xw_instance = xw_instance;
+  queued.type = XWalkExtensionMessageQueue::MessageType::ASYNC_REPLY;
+  queued.request_id = request_id;
+  queued.data = reply;
+  if (PostToMainThread(queued))
+    return;
+
+  XWalkExtensionInstance* instance = GetExtensionInstance(xw_instance);
+  CHECK(instance, xw_instance);
+  instance->AsyncReplyToJS(request_id, reply);
+}
+
+void XWalkExtensionAdapter::InstancePoolRegisterResetCallback(
+    XW_Extension xw_extension,
+    XW_ResetInstanceCallback reset) {
+  XWalkExtension* extension = GetExtension(xw_extension);
+  CHECK(extension, xw_extension);
+  RETURN_IF_INITIALIZED(extension);
+  extension->reset_instance_callback_ = reset;
+}
+
 void XWalkExtensionAdapter::EntryPointsSetExtraJSEntryPoints(
     XW_Extension xw_extension,
     const char** entry_points) {
@@ -253,8 +409,15 @@ void XWalkExtensionAdapter::EntryPointsSetExtraJSEntryPoints(
   CHECK(extension, xw_extension);
   RETURN_IF_INITIALIZED(extension);
 
+  // The entry points are set again when an unloaded extension is reloaded.
+  std::lock_guard<std::mutex> lock(extension->info_mutex_);
+  XWalkExtension::StringVector& current = extension->entry_points_;
   for (int i=0; entry_points[i]; ++i) {
-    extension->entry_points_.push_back(std::string(entry_points[i]));
+    std::string entry_point(entry_points[i]);
+    if (std::find(current.begin(), current.end(), entry_point) ==
+        current.end()) {
+      current.push_back(entry_point);
+    }
   }
 }
 
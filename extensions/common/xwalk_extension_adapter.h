@@ -6,12 +6,18 @@
 #ifndef XWALK_EXTENSIONS_XWALK_EXTENSION_ADAPTER_H_
 #define XWALK_EXTENSIONS_XWALK_EXTENSION_ADAPTER_H_
 
-#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 
 #include "extensions/common/xwalk_extension.h"
 #include "extensions/common/xwalk_extension_instance.h"
+#include "extensions/common/xwalk_extension_message_queue.h"
+#include "extensions/common/xwalk_extension_slot_map.h"
 #include "extensions/public/XW_Extension.h"
 #include "extensions/public/XW_Extension_EntryPoints.h"
+#include "extensions/public/XW_Extension_InstancePool.h"
 #include "extensions/public/XW_Extension_Permissions.h"
 #include "extensions/public/XW_Extension_Runtime.h"
 #include "extensions/public/XW_Extension_SyncMessage.h"
@@ -20,8 +26,9 @@ namespace extensions {
 
 class XWalkExtensionAdapter {
  public:
-  typedef std::map<XW_Extension, XWalkExtension*> ExtensionMap;
-  typedef std::map<XW_Instance, XWalkExtensionInstance*> InstanceMap;
+  typedef XWalkExtensionSlotMap<XW_Extension, XWalkExtension> ExtensionMap;
+  typedef XWalkExtensionSlotMap<XW_Instance, XWalkExtensionInstance>
+      InstanceMap;
 
   static XWalkExtensionAdapter* GetInstance();
 
@@ -33,6 +40,18 @@ class XWalkExtensionAdapter {
 
   void RegisterInstance(XWalkExtensionInstance* instance);
   void UnregisterInstance(XWalkExtensionInstance* instance);
+  // Gives |instance| a new handle. The old handle becomes stale, so the
+  // messages and replies still on their way to it are dropped. Returns
+  // false if no handle is left.
+  bool RenewInstance(XWalkExtensionInstance* instance);
+
+  // Must be called on the thread running the ecore main loop before the
+  // extensions are loaded. Messages which extensions post from other threads
+  // are queued and delivered to JavaScript on this thread.
+  void AttachMessageLoop();
+  // Must be called on the same thread before ecore is shut down. The
+  // messages posted from other threads afterwards are dropped.
+  void DetachMessageLoop();
 
   // Returns the correct struct according to interface asked. This is
   // passed to external extensions in XW_Initialize() call.
@@ -44,6 +63,11 @@ class XWalkExtensionAdapter {
 
   static XWalkExtension* GetExtension(XW_Extension xw_extension);
   static XWalkExtensionInstance* GetExtensionInstance(XW_Instance xw_instance);
+  // Queues |message| if the calling thread is not the main thread.
+  static bool PostToMainThread(
+      const XWalkExtensionMessageQueue::Message& message);
+  static void DeliverMessage(
+      const XWalkExtensionMessageQueue::Message& message);
 
   static void CoreSetExtensionName(
       XW_Extension xw_extension, const char* name);
@@ -64,11 +88,24 @@ class XWalkExtensionAdapter {
       XW_HandleMessageCallback handle_message);
   static void MessagingPostMessage(
       XW_Instance xw_instance, const char* message);
+  static void MessagingRegisterBinaryMessageCallback(
+      XW_Extension xw_extension,
+      XW_HandleBinaryMessageCallback handle_binary_message);
+  static void MessagingPostBinaryMessage(
+      XW_Instance xw_instance, const void* data, size_t size);
   static void SyncMessagingRegister(
       XW_Extension xw_extension,
       XW_HandleSyncMessageCallback handle_sync_message);
   static void SyncMessagingSetSyncReply(
       XW_Instance xw_instance, const char* reply);
+  static void AsyncReplyRegister(
+      XW_Extension xw_extension,
+      XW_HandleAsyncMessageCallback handle_async_message);
+  static void AsyncReplySetReply(
+      XW_Instance xw_instance, int32_t request_id, const char* reply);
+  static void InstancePoolRegisterResetCallback(
+      XW_Extension xw_extension,
+      XW_ResetInstanceCallback reset);
   static void EntryPointsSetExtraJSEntryPoints(
       XW_Extension xw_extension, const char** entry_points);
   static void RuntimeGetStringVariable(
@@ -79,11 +116,19 @@ class XWalkExtensionAdapter {
   static int PermissionsRegisterPermissions(
       XW_Extension xw_extension, const char* perm_table);
 
+  // Extensions can be initialized on loader threads, so accesses to the
+  // extension handles are serialized.
+  mutable std::mutex extension_mutex_;
   ExtensionMap extension_map_;
+
+  // Extensions may post messages and access their instance data from their
+  // own threads, while the instances are created and destroyed on the main
+  // thread.
+  mutable std::mutex instance_mutex_;
   InstanceMap instance_map_;
 
-  XW_Extension next_xw_extension_;
-  XW_Instance next_xw_instance_;
+  std::thread::id main_thread_id_;
+  std::unique_ptr<XWalkExtensionMessageQueue> message_queue_;
 };
 
 }  // namespace extensions
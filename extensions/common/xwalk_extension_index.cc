@@ -0,0 +1,276 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "extensions/common/xwalk_extension_index.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "common/logger.h"
+
+namespace extensions {
+
+namespace {
+
+const char kIndexMagic[8] = {'X', 'W', 'E', 'X', 'T', 'I', 'D', 'X'};
+const uint32_t kIndexVersion = 4;
+
+// The header is followed by |num_extensions| records of
+//   name, lib, uint32 flags, uint32 instance pool size, uint32 instance pool
+//   timeout, uint32 count of entry points, entry points...
+// where every string is an uint32 length followed by the bytes.
+struct IndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_extensions;
+  int64_t dir_mtime_sec;
+  int64_t dir_mtime_nsec;
+  uint64_t files_hash;
+  uint64_t data_size;
+};
+
+// Flags of a record
+const uint32_t kWorkerThreadFlag = 1 << 0;
+const uint32_t kUnloadableFlag = 1 << 1;
+
+const uint64_t kFNVOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFNVPrime = 1099511628211ULL;
+
+void HashBytes(const void* data, size_t size, uint64_t* hash) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    *hash ^= bytes[i];
+    *hash *= kFNVPrime;
+  }
+}
+
+void HashString(const std::string& str, uint64_t* hash) {
+  // The terminating null separates the strings.
+  HashBytes(str.c_str(), str.size() + 1, hash);
+}
+
+void AppendUInt32(uint32_t value, std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendString(const std::string& str, std::string* buffer) {
+  AppendUInt32(static_cast<uint32_t>(str.size()), buffer);
+  buffer->append(str);
+}
+
+// Reads the records of the index from a mapped memory with bounds checks.
+class IndexReader {
+ public:
+  IndexReader(const char* data, size_t size)
+      : data_(data), size_(size), pos_(0) {}
+
+  bool ReadUInt32(uint32_t* value) {
+    if (size_ - pos_ < sizeof(*value))
+      return false;
+    memcpy(value, data_ + pos_, sizeof(*value));
+    pos_ += sizeof(*value);
+    return true;
+  }
+
+  bool ReadString(std::string* str) {
+    uint32_t length;
+    if (!ReadUInt32(&length) || size_ - pos_ < length)
+      return false;
+    str->assign(data_ + pos_, length);
+    pos_ += length;
+    return true;
+  }
+
+  bool ReadMeta(XWalkExtensionMeta* meta) {
+    uint32_t flags;
+    uint32_t num_entry_points;
+    if (!ReadString(&meta->name) || !ReadString(&meta->lib) ||
+        !ReadUInt32(&flags) || !ReadUInt32(&meta->instance_pool_size) ||
+        !ReadUInt32(&meta->instance_pool_timeout) ||
+        !ReadUInt32(&num_entry_points))
+      return false;
+    meta->worker_thread = (flags & kWorkerThreadFlag) != 0;
+    meta->unloadable = (flags & kUnloadableFlag) != 0;
+    for (uint32_t i = 0; i < num_entry_points; ++i) {
+      std::string entry_point;
+      if (!ReadString(&entry_point))
+        return false;
+      meta->entry_points.push_back(entry_point);
+    }
+    return true;
+  }
+
+  bool AtEnd() const { return pos_ == size_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t pos_;
+};
+
+bool WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+}  // namespace
+
+XWalkExtensionIndex::XWalkExtensionIndex(const std::string& index_path)
+    : index_path_(index_path) {
+}
+
+XWalkExtensionIndex::~XWalkExtensionIndex() {
+}
+
+// static
+bool XWalkExtensionIndex::MakeKey(const std::string& dir,
+                                  const std::vector<std::string>& files,
+                                  const std::vector<std::string>& meta_files,
+                                  Key* key) {
+  struct stat dir_stat;
+  if (stat(dir.c_str(), &dir_stat) != 0) {
+    LOGGER(ERROR) << "Fail to stat " << dir;
+    return false;
+  }
+  key->dir_mtime_sec = dir_stat.st_mtim.tv_sec;
+  key->dir_mtime_nsec = dir_stat.st_mtim.tv_nsec;
+
+  // Metadata files which are modified in place don't touch the directory,
+  // so their own modification times and sizes are a part of the key.
+  uint64_t hash = kFNVOffsetBasis;
+  for (auto it = files.begin(); it != files.end(); ++it) {
+    HashString(*it, &hash);
+  }
+  for (auto it = meta_files.begin(); it != meta_files.end(); ++it) {
+    struct stat meta_stat;
+    if (stat(it->c_str(), &meta_stat) != 0)
+      return false;
+    int64_t stamp[] = {
+      meta_stat.st_mtim.tv_sec, meta_stat.st_mtim.tv_nsec, meta_stat.st_size
+    };
+    HashString(*it, &hash);
+    HashBytes(stamp, sizeof(stamp), &hash);
+  }
+  key->files_hash = hash;
+  return true;
+}
+
+bool XWalkExtensionIndex::Load(const Key& key,
+                               XWalkExtensionMetaList* metas) const {
+  int fd = open(index_path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  struct stat index_stat;
+  if (fstat(fd, &index_stat) != 0 ||
+      static_cast<size_t>(index_stat.st_size) < sizeof(IndexHeader)) {
+    close(fd);
+    return false;
+  }
+  size_t size = index_stat.st_size;
+  void* addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    LOGGER(ERROR) << "Fail to map the extension index " << index_path_;
+    return false;
+  }
+
+  IndexHeader header;
+  memcpy(&header, addr, sizeof(header));
+  bool valid = memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) == 0 &&
+               header.version == kIndexVersion &&
+               header.dir_mtime_sec == key.dir_mtime_sec &&
+               header.dir_mtime_nsec == key.dir_mtime_nsec &&
+               header.files_hash == key.files_hash &&
+               header.data_size == size - sizeof(header);
+
+  XWalkExtensionMetaList result;
+  if (valid) {
+    IndexReader reader(static_cast<const char*>(addr) + sizeof(header),
+                       header.data_size);
+    for (uint32_t i = 0; valid && i < header.num_extensions; ++i) {
+      XWalkExtensionMeta meta;
+      valid = reader.ReadMeta(&meta);
+      result.push_back(meta);
+    }
+    valid = valid && reader.AtEnd();
+    if (!valid) {
+      LOGGER(WARN) << "The extension index " << index_path_ << " is broken.";
+    }
+  }
+  munmap(addr, size);
+
+  if (!valid)
+    return false;
+  metas->swap(result);
+  return true;
+}
+
+bool XWalkExtensionIndex::Save(const Key& key,
+                               const XWalkExtensionMetaList& metas) const {
+  std::string data;
+  for (auto it = metas.begin(); it != metas.end(); ++it) {
+    AppendString(it->name, &data);
+    AppendString(it->lib, &data);
+    AppendUInt32((it->worker_thread ? kWorkerThreadFlag : 0) |
+                 (it->unloadable ? kUnloadableFlag : 0), &data);
+    AppendUInt32(it->instance_pool_size, &data);
+    AppendUInt32(it->instance_pool_timeout, &data);
+    AppendUInt32(static_cast<uint32_t>(it->entry_points.size()), &data);
+    for (auto entry = it->entry_points.begin();
+         entry != it->entry_points.end(); ++entry) {
+      AppendString(*entry, &data);
+    }
+  }
+
+  IndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+  header.version = kIndexVersion;
+  header.num_extensions = static_cast<uint32_t>(metas.size());
+  header.dir_mtime_sec = key.dir_mtime_sec;
+  header.dir_mtime_nsec = key.dir_mtime_nsec;
+  header.files_hash = key.files_hash;
+  header.data_size = data.size();
+
+  // Renderers of other applications may read or write the index at the same
+  // time, so the new index is written aside and renamed over the old one.
+  std::string temp_path = index_path_ + ".XXXXXX";
+  int fd = mkstemp(&temp_path[0]);
+  if (fd < 0) {
+    LOGGER(WARN) << "Fail to create the extension index " << temp_path;
+    return false;
+  }
+  bool written =
+      WriteAll(fd, reinterpret_cast<const char*>(&header), sizeof(header)) &&
+      WriteAll(fd, data.data(), data.size());
+  close(fd);
+  if (!written || rename(temp_path.c_str(), index_path_.c_str()) != 0) {
+    LOGGER(WARN) << "Fail to write the extension index " << index_path_;
+    unlink(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace extensions
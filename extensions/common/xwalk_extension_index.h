@@ -0,0 +1,73 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_INDEX_H_
+#define XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_INDEX_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace extensions {
+
+// Extension information read from a metadata file.
+struct XWalkExtensionMeta {
+  XWalkExtensionMeta()
+      : worker_thread(false),
+        unloadable(false),
+        instance_pool_size(0),
+        instance_pool_timeout(0) {}
+  std::string name;
+  std::string lib;
+  std::vector<std::string> entry_points;
+  bool worker_thread;
+  // Whether the library may be closed while the extension is not used.
+  bool unloadable;
+  // The pool of released instances, in instances and seconds.
+  uint32_t instance_pool_size;
+  uint32_t instance_pool_timeout;
+};
+
+typedef std::vector<XWalkExtensionMeta> XWalkExtensionMetaList;
+
+// Persistent index of the extension metadata found in an extension
+// directory. The index is a single binary file which is read with one mmap,
+// instead of opening and parsing every metadata file on each renderer start.
+//
+// The index is keyed to the modification time of the directory and to the
+// list of files in it (including the modification times of the metadata
+// files), so it becomes stale whenever the platform updates the extensions.
+class XWalkExtensionIndex {
+ public:
+  struct Key {
+    int64_t dir_mtime_sec;
+    int64_t dir_mtime_nsec;
+    uint64_t files_hash;
+  };
+
+  explicit XWalkExtensionIndex(const std::string& index_path);
+  ~XWalkExtensionIndex();
+
+  // Computes the key of |dir| whose entries are |files|. |meta_files| are
+  // the metadata files among them.
+  static bool MakeKey(const std::string& dir,
+                      const std::vector<std::string>& files,
+                      const std::vector<std::string>& meta_files,
+                      Key* key);
+
+  // Reads the index. Returns false if there is no index or if it was built
+  // for another key.
+  bool Load(const Key& key, XWalkExtensionMetaList* metas) const;
+
+  // Replaces the index with |metas| built for |key|.
+  bool Save(const Key& key, const XWalkExtensionMetaList& metas) const;
+
+ private:
+  std::string index_path_;
+};
+
+}  // namespace extensions
+
+#endif  // XWALK_EXTENSIONS_COMMON_XWALK_EXTENSION_INDEX_H_
@@ -5,7 +5,12 @@
 
 #include "extensions/common/xwalk_extension_instance.h"
 
+#include <string>
+
+#include "common/logger.h"
 #include "extensions/common/xwalk_extension_adapter.h"
+#include "extensions/common/xwalk_extension_metrics.h"
+#include "extensions/common/xwalk_extension_worker.h"
 #include "extensions/public/XW_Extension_SyncMessage.h"
 
 namespace extensions {
@@ -15,49 +20,221 @@ XWalkExtensionInstance::XWalkExtensionInstance(
   : extension_(extension),
     xw_instance_(xw_instance),
     instance_data_(NULL) {
+  extension_->instance_count_++;
   XWalkExtensionAdapter::GetInstance()->RegisterInstance(this);
   XW_CreatedInstanceCallback callback = extension_->created_instance_callback_;
-  if (callback)
-    callback(xw_instance_);
+  if (callback) {
+    RunOnExtensionThread([callback, xw_instance]() {
+      callback(xw_instance);
+    });
+  }
 }
 
 XWalkExtensionInstance::~XWalkExtensionInstance() {
   XW_DestroyedInstanceCallback callback =
       extension_->destroyed_instance_callback_;
-  if (callback)
-    callback(xw_instance_);
+  if (callback) {
+    // The callback runs after the messages already posted to the worker,
+    // and the instance data is still available to it.
+    XWalkExtensionWorker* worker = extension_->worker();
+    if (worker) {
+      XW_Instance xw_instance = xw_instance_;
+      worker->RunTaskAndWait([callback, xw_instance]() {
+        callback(xw_instance);
+      });
+    } else {
+      callback(xw_instance_);
+    }
+  }
   XWalkExtensionAdapter::GetInstance()->UnregisterInstance(this);
+  extension_->instance_count_--;
 }
 
 void XWalkExtensionInstance::HandleMessage(const std::string& msg) {
+  XWalkExtensionStats* stats = extension_->stats_;
+  if (stats) {
+    stats->Add(&stats->messages_to_native, 1);
+    stats->Add(&stats->bytes_to_native, msg.size());
+  }
   XW_HandleMessageCallback callback = extension_->handle_msg_callback_;
-  if (callback)
-    callback(xw_instance_, msg.c_str());
+  if (callback) {
+    XW_Instance xw_instance = xw_instance_;
+    RunOnExtensionThread([callback, xw_instance, msg, stats]() {
+      XWalkExtensionCallbackScope scope(stats, "HandleMessage");
+      callback(xw_instance, msg.c_str());
+    });
+  }
 }
 
 void XWalkExtensionInstance::HandleSyncMessage(const std::string& msg) {
+  XWalkExtensionStats* stats = extension_->stats_;
+  if (stats) {
+    stats->Add(&stats->messages_to_native, 1);
+    stats->Add(&stats->bytes_to_native, msg.size());
+  }
   XW_HandleSyncMessageCallback callback = extension_->handle_sync_msg_callback_;
   if (callback) {
-    callback(xw_instance_, msg.c_str());
+    // Measures how long the caller is blocked, including the wait for the
+    // worker.
+    uint64_t start_us = stats ? XWalkExtensionMetrics::NowMicroseconds() : 0;
+    XWalkExtensionWorker* worker = extension_->worker();
+    if (worker) {
+      // The reply is set from the worker while this thread waits for it.
+      XW_Instance xw_instance = xw_instance_;
+      worker->RunTaskAndWait([callback, xw_instance, &msg, stats]() {
+        XWalkExtensionCallbackScope scope(stats, "HandleSyncMessage");
+        callback(xw_instance, msg.c_str());
+      });
+    } else {
+      XWalkExtensionCallbackScope scope(stats, "HandleSyncMessage");
+      callback(xw_instance_, msg.c_str());
+    }
+    if (stats)
+      stats->AddSyncTime(XWalkExtensionMetrics::NowMicroseconds() - start_us);
   }
 }
 
+void XWalkExtensionInstance::HandleBinaryMessage(const void* data,
+                                                 size_t size) {
+  XW_HandleBinaryMessageCallback callback =
+      extension_->handle_binary_msg_callback_;
+  if (!callback) {
+    LOGGER(WARN) << "Extension '" << extension_->name()
+                 << "' doesn't handle binary messages.";
+    return;
+  }
+  XWalkExtensionStats* stats = extension_->stats_;
+  if (stats) {
+    stats->Add(&stats->messages_to_native, 1);
+    stats->Add(&stats->bytes_to_native, size);
+  }
+  XWalkExtensionWorker* worker = extension_->worker();
+  if (worker) {
+    // The buffer of the caller is valid only during this call.
+    XW_Instance xw_instance = xw_instance_;
+    std::string buffer(static_cast<const char*>(data), size);
+    worker->PostTask([callback, xw_instance, buffer, stats]() {
+      XWalkExtensionCallbackScope scope(stats, "HandleBinaryMessage");
+      callback(xw_instance, buffer.data(), buffer.size());
+    });
+    return;
+  }
+  XWalkExtensionCallbackScope scope(stats, "HandleBinaryMessage");
+  callback(xw_instance_, data, size);
+}
+
+void XWalkExtensionInstance::HandleAsyncMessage(int32_t request_id,
+                                                const std::string& msg) {
+  XW_HandleAsyncMessageCallback callback =
+      extension_->handle_async_msg_callback_;
+  if (callback) {
+    XWalkExtensionStats* stats = extension_->stats_;
+    if (stats) {
+      stats->Add(&stats->messages_to_native, 1);
+      stats->Add(&stats->bytes_to_native, msg.size());
+    }
+    XW_Instance xw_instance = xw_instance_;
+    RunOnExtensionThread([callback, xw_instance, request_id, msg, stats]() {
+      XWalkExtensionCallbackScope scope(stats, "HandleAsyncMessage");
+      callback(xw_instance, request_id, msg.c_str());
+    });
+    return;
+  }
+
+  // The extension supports only the synchronous reply, so the request is
+  // answered at once with it.
+  std::string reply;
+  MessageCallback sync_reply_callback = send_sync_reply_callback_;
+  send_sync_reply_callback_ = [&reply](const std::string& msg) {
+    reply = msg;
+  };
+  HandleSyncMessage(msg);
+  send_sync_reply_callback_ = sync_reply_callback;
+  AsyncReplyToJS(request_id, reply);
+}
+
+void XWalkExtensionInstance::RunOnExtensionThread(
+    std::function<void()> task) {
+  XWalkExtensionWorker* worker = extension_->worker();
+  if (worker)
+    worker->PostTask(task);
+  else
+    task();
+}
+
 void XWalkExtensionInstance::SetPostMessageCallback(
     MessageCallback callback) {
   post_message_callback_ = callback;
 }
 
+void XWalkExtensionInstance::SetPostBinaryMessageCallback(
+    BinaryMessageCallback callback) {
+  post_binary_message_callback_ = callback;
+}
+
+void XWalkExtensionInstance::SetAsyncReplyCallback(
+    AsyncReplyCallback callback) {
+  async_reply_callback_ = callback;
+}
+
 void XWalkExtensionInstance::SetSendSyncReplyCallback(
     MessageCallback callback) {
   send_sync_reply_callback_ = callback;
 }
 
+void XWalkExtensionInstance::Reset() {
+  post_message_callback_ = nullptr;
+  post_binary_message_callback_ = nullptr;
+  send_sync_reply_callback_ = nullptr;
+  async_reply_callback_ = nullptr;
+
+  XW_ResetInstanceCallback callback = extension_->reset_instance_callback_;
+  if (callback) {
+    XWalkExtensionWorker* worker = extension_->worker();
+    if (worker) {
+      XW_Instance xw_instance = xw_instance_;
+      worker->RunTaskAndWait([callback, xw_instance]() {
+        callback(xw_instance);
+      });
+    } else {
+      callback(xw_instance_);
+    }
+  }
+}
+
 void XWalkExtensionInstance::PostMessageToJS(const std::string& msg) {
-  post_message_callback_(msg);
+  CountMessageToJS(msg.size());
+  // Instances in the pool are not attached to any page.
+  if (post_message_callback_)
+    post_message_callback_(msg);
 }
 
 void XWalkExtensionInstance::SyncReplyToJS(const std::string& reply) {
-  send_sync_reply_callback_(reply);
+  CountMessageToJS(reply.size());
+  if (send_sync_reply_callback_)
+    send_sync_reply_callback_(reply);
+}
+
+void XWalkExtensionInstance::AsyncReplyToJS(int32_t request_id,
+                                            const std::string& reply) {
+  CountMessageToJS(reply.size());
+  if (async_reply_callback_)
+    async_reply_callback_(request_id, reply);
+}
+
+void XWalkExtensionInstance::PostBinaryMessageToJS(const void* data,
+                                                   size_t size) {
+  CountMessageToJS(size);
+  if (post_binary_message_callback_)
+    post_binary_message_callback_(data, size);
+}
+
+void XWalkExtensionInstance::CountMessageToJS(size_t size) {
+  XWalkExtensionStats* stats = extension_->stats_;
+  if (stats) {
+    stats->Add(&stats->messages_to_js, 1);
+    stats->Add(&stats->bytes_to_js, size);
+  }
 }
 
 }  // namespace extensions
@@ -6,6 +6,8 @@
 #ifndef XWALK_EXTENSIONS_XWALK_EXTENSION_INSTANCE_H_
 #define XWALK_EXTENSIONS_XWALK_EXTENSION_INSTANCE_H_
 
+#include <stdint.h>
+
 #include <functional>
 #include <string>
 
@@ -18,21 +20,40 @@ class XWalkExtension;
 class XWalkExtensionInstance {
  public:
   typedef std::function<void(const std::string&)> MessageCallback;
+  typedef std::function<void(const void*, size_t)> BinaryMessageCallback;
+  typedef std::function<void(int32_t, const std::string&)> AsyncReplyCallback;
 
   XWalkExtensionInstance(XWalkExtension* extension, XW_Instance xw_instance);
   virtual ~XWalkExtensionInstance();
 
   void HandleMessage(const std::string& msg);
   void HandleSyncMessage(const std::string& msg);
+  void HandleBinaryMessage(const void* data, size_t size);
+  void HandleAsyncMessage(int32_t request_id, const std::string& msg);
 
   void SetPostMessageCallback(MessageCallback callback);
+  void SetPostBinaryMessageCallback(BinaryMessageCallback callback);
   void SetSendSyncReplyCallback(MessageCallback callback);
+  void SetAsyncReplyCallback(AsyncReplyCallback callback);
+
+  XWalkExtension* extension() const { return extension_; }
 
  private:
+  friend class XWalkExtension;
   friend class XWalkExtensionAdapter;
 
+  // Detaches the instance from its page when it is released to the pool.
+  void Reset();
+
+  // Runs |task| on the worker thread of the extension, or at once on the
+  // calling thread if the extension doesn't use a worker thread.
+  void RunOnExtensionThread(std::function<void()> task);
+
   void PostMessageToJS(const std::string& msg);
   void SyncReplyToJS(const std::string& reply);
+  void PostBinaryMessageToJS(const void* data, size_t size);
+  void AsyncReplyToJS(int32_t request_id, const std::string& reply);
+  void CountMessageToJS(size_t size);
 
   XWalkExtension* extension_;
   XW_Instance xw_instance_;
@@ -40,6 +61,8 @@ class XWalkExtensionInstance {
 
   MessageCallback post_message_callback_;
   MessageCallback send_sync_reply_callback_;
+  BinaryMessageCallback post_binary_message_callback_;
+  AsyncReplyCallback async_reply_callback_;
 };
 
 }  // namespace extensions
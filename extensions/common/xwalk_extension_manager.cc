@@ -5,30 +5,73 @@
 #include "extensions/common/xwalk_extension_manager.h"
 
 #include <glob.h>
+#include <stdlib.h>
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <functional>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "common/app_db.h"
+#include "common/constants.h"
 #include "common/logger.h"
 #include "common/picojson.h"
 #include "common/file_utils.h"
+#include "common/profiler.h"
 #include "common/string_utils.h"
 
 #include "extensions/common/constants.h"
 #include "extensions/common/xwalk_extension.h"
+#include "extensions/common/xwalk_extension_index.h"
 
 namespace extensions {
 
 namespace {
 
-const char kAppDBRuntimeSection[] = "Runtime";
-
 const char kExtensionPrefix[] = "lib";
 const char kExtensionSuffix[] = ".so";
 const char kExtensionMetadataSuffix[] = ".json";
+const char kExtensionIndexDir[] = "xwalk-extension";
+const char kExtensionIndexFile[] = "xwalk-extension-index";
+
+// Idle timeout of the pooled instances, in seconds, if the metadata doesn't
+// specify it.
+const unsigned int kDefaultInstancePoolTimeout = 30;
+
+// Upper bound of the loader threads used by the parallel loading.
+const unsigned int kMaxLoaderThreads = 4;
+
+// Runs |job| for every index in [0, count) on a small pool of threads and
+// returns after all of them are done.
+void RunInParallel(size_t count, std::function<void(size_t)> job) {
+  unsigned int num_threads = std::thread::hardware_concurrency();
+  if (num_threads == 0)
+    num_threads = 1;
+  num_threads = std::min(num_threads, kMaxLoaderThreads);
+  num_threads = std::min<size_t>(num_threads, count);
+
+  std::atomic<size_t> next_index(0);
+  auto worker = [&next_index, count, &job]() {
+    size_t index;
+    while ((index = next_index++) < count) {
+      job(index);
+    }
+  };
+
+  // The calling thread works as one of the loaders.
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < num_threads; ++i) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (auto it = threads.begin(); it != threads.end(); ++it) {
+    it->join();
+  }
+}
 
 }  // namespace
 
@@ -38,7 +81,7 @@ XWalkExtensionManager::XWalkExtensionManager() {
 XWalkExtensionManager::~XWalkExtensionManager() {
 }
 
-void XWalkExtensionManager::LoadExtensions(bool meta_only) {
+void XWalkExtensionManager::LoadExtensions(bool meta_only, bool parallel) {
   if (!extensions_.empty()) {
     return;
   }
@@ -48,42 +91,123 @@ void XWalkExtensionManager::LoadExtensions(bool meta_only) {
 #else
   #error EXTENSION_PATH is not set.
 #endif
-  // Gets all extension files in the EXTENSION_PATH
-  std::string ext_pattern(extension_path);
-  ext_pattern.append("/");
-  ext_pattern.append(kExtensionPrefix);
-  ext_pattern.append("*");
-  ext_pattern.append(kExtensionSuffix);
+  // Gets all extension files and metadata files in the EXTENSION_PATH
+  std::string pattern(extension_path);
+  pattern.append("/*");
+  StringVector all_files;
   StringSet files;
+  StringVector meta_files;
   {
     glob_t glob_result;
-    glob(ext_pattern.c_str(), GLOB_TILDE, NULL, &glob_result);
+    glob(pattern.c_str(), GLOB_TILDE, NULL, &glob_result);
     for (unsigned int i = 0; i < glob_result.gl_pathc; ++i) {
-      files.insert(glob_result.gl_pathv[i]);
+      std::string path(glob_result.gl_pathv[i]);
+      std::string filename = path.substr(path.rfind('/') + 1);
+      all_files.push_back(path);
+      if (common::utils::StartsWith(filename, kExtensionPrefix) &&
+          common::utils::EndsWith(filename, kExtensionSuffix)) {
+        files.insert(path);
+      } else if (common::utils::EndsWith(filename,
+                                         kExtensionMetadataSuffix)) {
+        meta_files.push_back(path);
+      }
     }
+    globfree(&glob_result);
   }
 
-  // Gets all metadata files in the EXTENSION_PATH
-  // Loads information from the metadata files and remove the loaded file from
-  // the set 'files'
-  std::string meta_pattern(extension_path);
-  meta_pattern.append("/");
-  meta_pattern.append("*");
-  meta_pattern.append(kExtensionMetadataSuffix);
-  {
-    glob_t glob_result;
-    glob(meta_pattern.c_str(), GLOB_TILDE, NULL, &glob_result);
-    for (unsigned int i = 0; i < glob_result.gl_pathc; ++i) {
-      RegisterExtensionsByMeta(glob_result.gl_pathv[i], &files);
+  // Loads information from the metadata files. The cached index is used
+  // instead of the files while the extension directory is not changed.
+  // The index is not used if the cache directory of the user is not safe.
+  std::string index_dir = common::utils::GetUserCacheDir(kExtensionIndexDir);
+  XWalkExtensionIndex index(index_dir + "/" + kExtensionIndexFile);
+  XWalkExtensionIndex::Key key;
+  bool has_key = !index_dir.empty() &&
+                 XWalkExtensionIndex::MakeKey(extension_path, all_files,
+                                              meta_files, &key);
+  XWalkExtensionMetaList metas;
+  if (!has_key || !index.Load(key, &metas)) {
+    ParseExtensionsMetaFiles(meta_files, parallel, &metas);
+    if (has_key) {
+      index.Save(key, metas);
     }
   }
 
+  // Registers the extensions in the metadata and remove the loaded file from
+  // the set 'files'
+  RegisterExtensionsByMeta(metas, &files);
+
+  if (meta_only)
+    return;
+
   // Load extensions in the remained files of the set 'files'
-  if (!meta_only) {
+  if (!parallel) {
     for (auto it = files.begin(); it != files.end(); ++it) {
       XWalkExtension* ext = new XWalkExtension(*it, this);
       RegisterExtension(ext);
     }
+    return;
+  }
+
+  SCOPE_PROFILE();
+  StringVector libs(files.begin(), files.end());
+  std::vector<XWalkExtension*> extensions(libs.size());
+  for (size_t i = 0; i < libs.size(); ++i) {
+    extensions[i] = new XWalkExtension(libs[i], this);
+  }
+  std::vector<char> initialized(libs.size(), false);
+  RunInParallel(libs.size(), [&](size_t i) {
+    initialized[i] = extensions[i]->Initialize();
+  });
+  for (size_t i = 0; i < extensions.size(); ++i) {
+    if (initialized[i]) {
+      RegisterExtension(extensions[i]);
+    } else {
+      delete extensions[i];
+    }
+  }
+}
+
+void XWalkExtensionManager::UnloadIdleExtensions(double idle_time,
+                                                 bool clear_pools) {
+  SCOPE_PROFILE();
+  int unloaded = 0;
+  for (auto it = extensions_.begin(); it != extensions_.end(); ++it) {
+    if (clear_pools) {
+      it->second->ClearInstancePool();
+    }
+    if (it->second->UnloadIfIdle(idle_time)) {
+      unloaded++;
+    }
+  }
+  if (unloaded > 0) {
+    LOGGER(DEBUG) << unloaded << " idle extensions are unloaded.";
+  }
+}
+
+// static
+void XWalkExtensionManager::ParseExtensionsMetaFiles(
+    const StringVector& meta_files, bool parallel,
+    XWalkExtensionMetaList* metas) {
+  SCOPE_PROFILE();
+
+  // Each metadata file is parsed into its own slot, and the slots are
+  // concatenated in the order of the files afterwards.
+  std::vector<XWalkExtensionMetaList> file_metas(meta_files.size());
+  std::vector<char> parsed(meta_files.size(), false);
+  auto parse = [&](size_t i) {
+    parsed[i] = ParseExtensionsMeta(meta_files[i], &file_metas[i]);
+  };
+  if (parallel) {
+    RunInParallel(meta_files.size(), parse);
+  } else {
+    for (size_t i = 0; i < meta_files.size(); ++i) {
+      parse(i);
+    }
+  }
+  for (size_t i = 0; i < file_metas.size(); ++i) {
+    if (parsed[i]) {
+      metas->insert(metas->end(), file_metas[i].begin(), file_metas[i].end());
+    }
   }
 }
 
@@ -130,7 +254,22 @@ void XWalkExtensionManager::RegisterExtension(XWalkExtension* extension) {
 }
 
 void XWalkExtensionManager::RegisterExtensionsByMeta(
-    const std::string& meta_path, StringSet* files) {
+    const XWalkExtensionMetaList& metas, StringSet* files) {
+  for (auto it = metas.begin(); it != metas.end(); ++it) {
+    XWalkExtension* extension =
+        new XWalkExtension(it->lib, it->name, it->entry_points, this);
+    extension->set_use_worker_thread(it->worker_thread);
+    extension->set_unloadable(it->unloadable);
+    extension->set_instance_pool(it->instance_pool_size,
+                                 it->instance_pool_timeout);
+    RegisterExtension(extension);
+    files->erase(it->lib);
+  }
+}
+
+// static
+bool XWalkExtensionManager::ParseExtensionsMeta(
+    const std::string& meta_path, XWalkExtensionMetaList* metas) {
 #ifdef EXTENSION_PATH
   std::string extension_path(EXTENSION_PATH);
 #else
@@ -140,49 +279,91 @@ void XWalkExtensionManager::RegisterExtensionsByMeta(
   std::ifstream metafile(meta_path.c_str());
   if (!metafile.is_open()) {
     LOGGER(ERROR) << "Fail to open the plugin metadata file :" << meta_path;
-    return;
+    return false;
   }
 
   picojson::value metadata;
   metafile >> metadata;
-    if (metadata.is<picojson::array>()) {
-    auto& plugins = metadata.get<picojson::array>();
-    for (auto plugin = plugins.begin(); plugin != plugins.end(); ++plugin) {
-      if (!plugin->is<picojson::object>())
-        continue;
-
-      std::string name = plugin->get("name").to_str();
-      std::string lib = plugin->get("lib").to_str();
-      if (!common::utils::StartsWith(lib, "/")) {
-        lib = extension_path + "/" + lib;
-      }
+  metafile.close();
+  if (!metadata.is<picojson::array>()) {
+    LOGGER(ERROR) << meta_path << " is not a valid metadata file.";
+    return false;
+  }
+
+  auto& plugins = metadata.get<picojson::array>();
+  for (auto plugin = plugins.begin(); plugin != plugins.end(); ++plugin) {
+    if (!plugin->is<picojson::object>())
+      continue;
+
+    XWalkExtensionMeta meta;
+    meta.name = plugin->get("name").to_str();
+    meta.lib = plugin->get("lib").to_str();
+    if (!common::utils::StartsWith(meta.lib, "/")) {
+      meta.lib = extension_path + "/" + meta.lib;
+    }
 
-      std::vector<std::string> entries;
-      auto& entry_points_value = plugin->get("entry_points");
-      if (entry_points_value.is<picojson::array>()) {
-        auto& entry_points = entry_points_value.get<picojson::array>();
-        for (auto entry = entry_points.begin(); entry != entry_points.end();
-             ++entry) {
-          entries.push_back(entry->to_str());
+    auto& worker_thread_value = plugin->get("worker_thread");
+    meta.worker_thread = worker_thread_value.is<bool>() &&
+                         worker_thread_value.get<bool>();
+
+    // The library is closed when idle only if the extension says it leaves
+    // no callbacks into it behind after its shutdown callback.
+    auto& unloadable_value = plugin->get("unloadable");
+    meta.unloadable = unloadable_value.is<bool>() &&
+                      unloadable_value.get<bool>();
+
+    // "instance_pool": {"size": 2, "idle_timeout": 30}
+    auto& pool_value = plugin->get("instance_pool");
+    if (pool_value.is<picojson::object>()) {
+      auto& size_value = pool_value.get("size");
+      auto& timeout_value = pool_value.get("idle_timeout");
+      if (size_value.is<double>() && size_value.get<double>() > 0) {
+        meta.instance_pool_size =
+            static_cast<uint32_t>(size_value.get<double>());
+        meta.instance_pool_timeout = kDefaultInstancePoolTimeout;
+        if (timeout_value.is<double>() && timeout_value.get<double>() > 0) {
+          meta.instance_pool_timeout =
+              static_cast<uint32_t>(timeout_value.get<double>());
         }
       }
-      XWalkExtension* extension = new XWalkExtension(lib, name, entries, this);
-      RegisterExtension(extension);
-      files->erase(lib);
     }
-  } else {
-    LOGGER(ERROR) << meta_path << " is not a valid metadata file.";
+
+    auto& entry_points_value = plugin->get("entry_points");
+    if (entry_points_value.is<picojson::array>()) {
+      auto& entry_points = entry_points_value.get<picojson::array>();
+      for (auto entry = entry_points.begin(); entry != entry_points.end();
+           ++entry) {
+        meta.entry_points.push_back(entry->to_str());
+      }
+    }
+    metas->push_back(meta);
   }
-  metafile.close();
+  return true;
 }
 
 // override
 void XWalkExtensionManager::GetRuntimeVariable(
     const char* key, char* value, size_t value_len) {
-  common::AppDB* db = common::AppDB::GetInstance();
-  std::string ret = db->Get(kAppDBRuntimeSection, key);
+  std::lock_guard<std::mutex> lock(runtime_variable_mutex_);
+  std::string ret;
+  auto it = runtime_variables_.find(key);
+  if (it != runtime_variables_.end()) {
+    ret = it->second;
+  } else if (getenv(common::kRuntimeVariableAppDBEnableKey) != NULL ||
+             getenv(kExtensionHostEnableKey) != NULL) {
+    // The runtime writes the variables to the AppDB only in these cases,
+    // and the extension host doesn't receive them from the runtime.
+    common::AppDB* db = common::AppDB::GetInstance();
+    ret = db->Get(common::kAppDBRuntimeSection, key);
+  }
   strncpy(value, ret.c_str(), value_len);
 }
 
+void XWalkExtensionManager::SetRuntimeVariable(const std::string& key,
+                                               const std::string& value) {
+  std::lock_guard<std::mutex> lock(runtime_variable_mutex_);
+  runtime_variables_[key] = value;
+}
+
 
 }  // namespace extensions
@@ -8,14 +8,18 @@
 #include <string>
 #include <set>
 #include <map>
+#include <mutex>
+#include <vector>
 
 #include "extensions/common/xwalk_extension.h"
+#include "extensions/common/xwalk_extension_index.h"
 
 namespace extensions {
 
 class XWalkExtensionManager : public XWalkExtension::XWalkExtensionDelegate {
  public:
   typedef std::set<std::string> StringSet;
+  typedef std::vector<std::string> StringVector;
   typedef std::map<std::string, XWalkExtension*> ExtensionMap;
 
   XWalkExtensionManager();
@@ -23,18 +27,43 @@ class XWalkExtensionManager : public XWalkExtension::XWalkExtensionDelegate {
 
   ExtensionMap extensions() const { return extensions_; }
 
-  void LoadExtensions(bool meta_only = true);
+  // The metadata of the extensions is read from a cached index, which is
+  // rebuilt when the extension directory is changed.
+  // If |parallel| is true, the metadata files are parsed and the libraries
+  // without metadata are initialized on a small thread pool. The results
+  // are registered in the same order as the serial loading does, so the
+  // conflicts of names and entry points are resolved identically.
+  void LoadExtensions(bool meta_only = true, bool parallel = false);
+
+  // Unloads the extensions which have no instances and were not used for
+  // |idle_time| seconds. If |clear_pools| is true, the pooled instances are
+  // destroyed first, so the extensions keeping them are unloaded as well.
+  void UnloadIdleExtensions(double idle_time, bool clear_pools = false);
+
+  // Sets a runtime variable which the extensions read from memory. The
+  // variables which are not set are read from the AppDB.
+  void SetRuntimeVariable(const std::string& key, const std::string& value);
  private:
   // override
   void GetRuntimeVariable(const char* key, char* value, size_t value_len);
 
   bool RegisterSymbols(XWalkExtension* extension);
   void RegisterExtension(XWalkExtension* extension);
-  void RegisterExtensionsByMeta(const std::string& meta_path,
+  void RegisterExtensionsByMeta(const XWalkExtensionMetaList& metas,
                                 StringSet* files);
 
+  static void ParseExtensionsMetaFiles(const StringVector& meta_files,
+                                       bool parallel,
+                                       XWalkExtensionMetaList* metas);
+  static bool ParseExtensionsMeta(const std::string& meta_path,
+                                  XWalkExtensionMetaList* metas);
+
   StringSet extension_symbols_;
   ExtensionMap extensions_;
+
+  // Extensions may ask for runtime variables from loader threads.
+  std::mutex runtime_variable_mutex_;
+  std::map<std::string, std::string> runtime_variables_;
 };
 
 }  // namespace extensions
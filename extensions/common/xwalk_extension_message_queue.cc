@@ -0,0 +1,108 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "extensions/common/xwalk_extension_message_queue.h"
+
+#include <string>
+
+#include "common/logger.h"
+
+namespace extensions {
+
+XWalkExtensionMessageQueue::XWalkExtensionMessageQueue(Handler handler)
+    : handler_(handler),
+      pipe_(NULL),
+      wakeup_pending_(false),
+      head_(&stub_),
+      tail_(&stub_) {
+  pipe_ = ecore_pipe_add(OnWakeup, this);
+  if (!pipe_) {
+    LOGGER(ERROR) << "Fail to create the pipe for extension messages.";
+  }
+}
+
+XWalkExtensionMessageQueue::~XWalkExtensionMessageQueue() {
+  Close();
+  Node* node;
+  while ((node = Dequeue()) != NULL) {
+    delete node;
+  }
+}
+
+void XWalkExtensionMessageQueue::Push(const Message& message) {
+  Node* node = new Node;
+  node->message = message;
+  Enqueue(node);
+
+  // Only the first message after a drain needs to wake the main loop up.
+  if (!wakeup_pending_.exchange(true)) {
+    std::lock_guard<std::mutex> lock(pipe_mutex_);
+    if (pipe_) {
+      char dummy = 0;
+      ecore_pipe_write(pipe_, &dummy, sizeof(dummy));
+    }
+  }
+}
+
+void XWalkExtensionMessageQueue::Close() {
+  std::lock_guard<std::mutex> lock(pipe_mutex_);
+  if (pipe_) {
+    ecore_pipe_del(pipe_);
+    pipe_ = NULL;
+  }
+}
+
+// static
+void XWalkExtensionMessageQueue::OnWakeup(void* data, void* /*buffer*/,
+                                          unsigned int /*nbyte*/) {
+  XWalkExtensionMessageQueue* self =
+      static_cast<XWalkExtensionMessageQueue*>(data);
+  self->Drain();
+}
+
+void XWalkExtensionMessageQueue::Enqueue(Node* node) {
+  node->next.store(nullptr, std::memory_order_relaxed);
+  Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+  prev->next.store(node, std::memory_order_release);
+}
+
+XWalkExtensionMessageQueue::Node* XWalkExtensionMessageQueue::Dequeue() {
+  Node* tail = tail_;
+  Node* next = tail->next.load(std::memory_order_acquire);
+  if (tail == &stub_) {
+    if (next == nullptr)
+      return nullptr;
+    tail_ = next;
+    tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next != nullptr) {
+    tail_ = next;
+    return tail;
+  }
+  if (tail != head_.load(std::memory_order_acquire)) {
+    // A producer is in the middle of Enqueue(). It wakes the main loop up
+    // again when it's done.
+    return nullptr;
+  }
+  Enqueue(&stub_);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next != nullptr) {
+    tail_ = next;
+    return tail;
+  }
+  return nullptr;
+}
+
+void XWalkExtensionMessageQueue::Drain() {
+  // Messages pushed from now on need another wakeup.
+  wakeup_pending_.store(false);
+  Node* node;
+  while ((node = Dequeue()) != NULL) {
+    handler_(node->message);
+    delete node;
+  }
+}
+
+}  // namespace extensions
@@ -0,0 +1,85 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_XWALK_EXTENSION_MESSAGE_QUEUE_H_
+#define XWALK_EXTENSIONS_XWALK_EXTENSION_MESSAGE_QUEUE_H_
+
+#include <Ecore.h>
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "extensions/public/XW_Extension.h"
+
+namespace extensions {
+
+// Carries the messages which extensions post from their own threads to the
+// thread running the ecore main loop.
+//
+// Any thread can Push() without locking (multiple producers, single
+// consumer). The first message pushed after a drain wakes the main loop up
+// through an ecore pipe, and the main loop drains the whole queue at once.
+class XWalkExtensionMessageQueue {
+ public:
+  enum class MessageType {
+    MESSAGE,
+    BINARY_MESSAGE,
+    ASYNC_REPLY
+  };
+
+  struct Message {
+    Message() : xw_instance(0), type(MessageType::MESSAGE), request_id(0) {}
+    XW_Instance xw_instance;
+    MessageType type;
+    int32_t request_id;
+    std::string data;
+  };
+
+  typedef std::function<void(const Message&)> Handler;
+
+  // Must be created on the thread running the ecore main loop. |handler| is
+  // called on that thread for each message.
+  explicit XWalkExtensionMessageQueue(Handler handler);
+  ~XWalkExtensionMessageQueue();
+
+  void Push(const Message& message);
+
+  // Deletes the pipe. Must be called on the thread running the ecore main
+  // loop before ecore is shut down. The messages pushed afterwards are never
+  // delivered.
+  void Close();
+
+ private:
+  struct Node {
+    Node() : next(nullptr) {}
+    std::atomic<Node*> next;
+    Message message;
+  };
+
+  static void OnWakeup(void* data, void* buffer, unsigned int nbyte);
+
+  void Enqueue(Node* node);
+  Node* Dequeue();
+  void Drain();
+
+  Handler handler_;
+  // Guards |pipe_|, which the producers use only to wake the main loop up.
+  std::mutex pipe_mutex_;
+  Ecore_Pipe* pipe_;
+  std::atomic<bool> wakeup_pending_;
+
+  // Producers exchange |head_|, the consumer owns |tail_|. |stub_| keeps
+  // the queue non-empty, so pushes never touch the consumer side.
+  std::atomic<Node*> head_;
+  Node* tail_;
+  Node stub_;
+};
+
+}  // namespace extensions
+
+#endif  // XWALK_EXTENSIONS_XWALK_EXTENSION_MESSAGE_QUEUE_H_
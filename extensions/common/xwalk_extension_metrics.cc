@@ -0,0 +1,204 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "extensions/common/xwalk_extension_metrics.h"
+
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#include "common/file_utils.h"
+#include "common/logger.h"
+#include "common/picojson.h"
+
+namespace extensions {
+
+namespace {
+
+const char kMetricsEnableKey[] = "WRT_EXTENSION_METRICS_ENABLE";
+const char kTraceEnableKey[] = "WRT_EXTENSION_TRACE_ENABLE";
+const char kMetricsFilePrefix[] = "xwalk-extension-metrics-";
+
+// Capacity of the trace event ring buffer.
+const size_t kMaxTraceEvents = 10000;
+
+}  // namespace
+
+// Both are read once when the library is loaded.
+const bool XWalkExtensionMetrics::enabled_ =
+    getenv(kMetricsEnableKey) != NULL || getenv(kTraceEnableKey) != NULL;
+const bool XWalkExtensionMetrics::tracing_ = getenv(kTraceEnableKey) != NULL;
+
+XWalkExtensionStats::XWalkExtensionStats(const std::string& extension_name)
+    : name(extension_name),
+      init_count(0),
+      init_time_us(0),
+      messages_to_native(0),
+      bytes_to_native(0),
+      messages_to_js(0),
+      bytes_to_js(0),
+      sync_messages(0),
+      sync_time_us(0),
+      sync_time_max_us(0),
+      callback_time_us(0) {
+}
+
+void XWalkExtensionStats::AddSyncTime(uint64_t time_us) {
+  Add(&sync_messages, 1);
+  Add(&sync_time_us, time_us);
+  uint64_t max = sync_time_max_us.load(std::memory_order_relaxed);
+  while (time_us > max &&
+         !sync_time_max_us.compare_exchange_weak(
+             max, time_us, std::memory_order_relaxed)) {
+  }
+}
+
+XWalkExtensionMetrics::XWalkExtensionMetrics()
+    : next_trace_event_(0) {
+}
+
+XWalkExtensionMetrics::~XWalkExtensionMetrics() {
+}
+
+// static
+XWalkExtensionMetrics* XWalkExtensionMetrics::GetInstance() {
+  static XWalkExtensionMetrics self;
+  return &self;
+}
+
+// static
+uint64_t XWalkExtensionMetrics::NowMicroseconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+XWalkExtensionStats* XWalkExtensionMetrics::GetStats(
+    const std::string& extension_name) {
+  if (!enabled_)
+    return NULL;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<XWalkExtensionStats>& stats = stats_[extension_name];
+  if (!stats)
+    stats.reset(new XWalkExtensionStats(extension_name));
+  return stats.get();
+}
+
+void XWalkExtensionMetrics::AddTraceEvent(const std::string& extension_name,
+                                          const char* event,
+                                          uint64_t start_us,
+                                          uint64_t duration_us) {
+  if (!tracing_)
+    return;
+
+  TraceEvent trace_event;
+  trace_event.name = extension_name + "." + event;
+  trace_event.start_us = start_us;
+  trace_event.duration_us = duration_us;
+  trace_event.tid = static_cast<pid_t>(syscall(SYS_gettid));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (trace_events_.size() < kMaxTraceEvents) {
+    trace_events_.push_back(trace_event);
+  } else {
+    trace_events_[next_trace_event_] = trace_event;
+  }
+  next_trace_event_ = (next_trace_event_ + 1) % kMaxTraceEvents;
+}
+
+std::string XWalkExtensionMetrics::GetSnapshotJSON() const {
+  picojson::object snapshot;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = stats_.begin(); it != stats_.end(); ++it) {
+    const XWalkExtensionStats& stats = *it->second;
+    picojson::object item;
+    auto set = [&item](const char* key, const std::atomic<uint64_t>& value) {
+      item[key] = picojson::value(static_cast<double>(
+          value.load(std::memory_order_relaxed)));
+    };
+    set("init_count", stats.init_count);
+    set("init_time_us", stats.init_time_us);
+    set("messages_to_native", stats.messages_to_native);
+    set("bytes_to_native", stats.bytes_to_native);
+    set("messages_to_js", stats.messages_to_js);
+    set("bytes_to_js", stats.bytes_to_js);
+    set("sync_messages", stats.sync_messages);
+    set("sync_time_us", stats.sync_time_us);
+    set("sync_time_max_us", stats.sync_time_max_us);
+    set("callback_time_us", stats.callback_time_us);
+    snapshot[it->first] = picojson::value(item);
+  }
+  return picojson::value(snapshot).serialize();
+}
+
+std::string XWalkExtensionMetrics::GetTraceEventsJSON() const {
+  picojson::array events;
+  double pid = static_cast<double>(getpid());
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The oldest event is at |next_trace_event_| once the buffer is full.
+  size_t count = trace_events_.size();
+  size_t first = count < kMaxTraceEvents ? 0 : next_trace_event_;
+  for (size_t i = 0; i < count; ++i) {
+    const TraceEvent& trace_event = trace_events_[(first + i) % count];
+    picojson::object event;
+    event["name"] = picojson::value(trace_event.name);
+    event["cat"] = picojson::value("extension");
+    event["ph"] = picojson::value("X");
+    event["ts"] = picojson::value(static_cast<double>(trace_event.start_us));
+    event["dur"] =
+        picojson::value(static_cast<double>(trace_event.duration_us));
+    event["pid"] = picojson::value(pid);
+    event["tid"] = picojson::value(static_cast<double>(trace_event.tid));
+    events.push_back(picojson::value(event));
+  }
+  picojson::object trace;
+  trace["traceEvents"] = picojson::value(events);
+  return picojson::value(trace).serialize();
+}
+
+std::string XWalkExtensionMetrics::GetJSON() const {
+  return "{\"extensions\":" + GetSnapshotJSON() +
+         ",\"trace\":" + GetTraceEventsJSON() + "}";
+}
+
+void XWalkExtensionMetrics::Dump(const std::string& host_json) const {
+  if (!enabled_)
+    return;
+
+  std::string path = common::utils::GetUserRuntimeDir() + "/" +
+                     kMetricsFilePrefix + std::to_string(getpid()) + ".json";
+  std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+  if (!out) {
+    LOGGER(ERROR) << "Failed to write extension metrics to " << path;
+    return;
+  }
+  if (host_json.empty()) {
+    out << GetJSON();
+  } else {
+    out << "{\"extensions\":" << GetSnapshotJSON()
+        << ",\"trace\":" << GetTraceEventsJSON()
+        << ",\"host\":" << host_json << "}";
+  }
+  LOGGER(DEBUG) << "Extension metrics are written to " << path;
+}
+
+XWalkExtensionCallbackScope::~XWalkExtensionCallbackScope() {
+  if (!stats_)
+    return;
+  uint64_t elapsed = Elapsed();
+  stats_->Add(&stats_->callback_time_us, elapsed);
+  XWalkExtensionMetrics::GetInstance()->AddTraceEvent(
+      stats_->name, event_, start_us_, elapsed);
+}
+
+uint64_t XWalkExtensionCallbackScope::Elapsed() const {
+  return XWalkExtensionMetrics::NowMicroseconds() - start_us_;
+}
+
+}  // namespace extensions
@@ -0,0 +1,124 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_XWALK_EXTENSION_METRICS_H_
+#define XWALK_EXTENSIONS_XWALK_EXTENSION_METRICS_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace extensions {
+
+// Counters of one extension. They are updated without locks from the main
+// thread and the worker thread of the extension.
+struct XWalkExtensionStats {
+  explicit XWalkExtensionStats(const std::string& extension_name);
+
+  void Add(std::atomic<uint64_t>* counter, uint64_t value) {
+    counter->fetch_add(value, std::memory_order_relaxed);
+  }
+  void AddSyncTime(uint64_t time_us);
+
+  const std::string name;
+
+  std::atomic<uint64_t> init_count;
+  std::atomic<uint64_t> init_time_us;
+  std::atomic<uint64_t> messages_to_native;
+  std::atomic<uint64_t> bytes_to_native;
+  std::atomic<uint64_t> messages_to_js;
+  std::atomic<uint64_t> bytes_to_js;
+  std::atomic<uint64_t> sync_messages;
+  std::atomic<uint64_t> sync_time_us;
+  std::atomic<uint64_t> sync_time_max_us;
+  // Time spent inside the callbacks of the extension.
+  std::atomic<uint64_t> callback_time_us;
+};
+
+// Collects the message counts and latencies of the extensions, to find the
+// ones causing jank. It is enabled by WRT_EXTENSION_METRICS_ENABLE, and
+// WRT_EXTENSION_TRACE_ENABLE additionally records each callback as a trace
+// event. When disabled, the extensions have no stats and the instrumented
+// paths only test a NULL pointer.
+class XWalkExtensionMetrics {
+ public:
+  static XWalkExtensionMetrics* GetInstance();
+
+  static bool enabled() { return enabled_; }
+  static bool tracing() { return tracing_; }
+
+  static uint64_t NowMicroseconds();
+
+  // Returns the counters of |extension_name|, which live as long as the
+  // process. Returns NULL if the metrics are disabled.
+  XWalkExtensionStats* GetStats(const std::string& extension_name);
+
+  // Records a complete trace event of |duration_us| which began at
+  // |start_us| on the calling thread.
+  void AddTraceEvent(const std::string& extension_name, const char* event,
+                     uint64_t start_us, uint64_t duration_us);
+
+  // The counters of all the extensions as a JSON object by their names.
+  std::string GetSnapshotJSON() const;
+  // The recorded events in the Trace Event Format, which chrome://tracing
+  // loads.
+  std::string GetTraceEventsJSON() const;
+
+  // The snapshot and the trace events as one JSON object.
+  std::string GetJSON() const;
+
+  // Writes GetJSON() into the runtime directory as
+  // "xwalk-extension-metrics-<pid>.json". |host_json| is the GetJSON() of
+  // the extension host, if any, and is written under "host".
+  void Dump(const std::string& host_json = std::string()) const;
+
+ private:
+  struct TraceEvent {
+    std::string name;
+    uint64_t start_us;
+    uint64_t duration_us;
+    pid_t tid;
+  };
+
+  XWalkExtensionMetrics();
+  virtual ~XWalkExtensionMetrics();
+
+  static const bool enabled_;
+  static const bool tracing_;
+
+  mutable std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<XWalkExtensionStats>> stats_;
+  // The latest events are kept in a ring buffer.
+  std::vector<TraceEvent> trace_events_;
+  size_t next_trace_event_;
+};
+
+// Measures the time spent in a callback of the extension with |stats|.
+// Does nothing if |stats| is NULL.
+class XWalkExtensionCallbackScope {
+ public:
+  XWalkExtensionCallbackScope(XWalkExtensionStats* stats, const char* event)
+      : stats_(stats), event_(event),
+        start_us_(stats ? XWalkExtensionMetrics::NowMicroseconds() : 0) {
+  }
+  ~XWalkExtensionCallbackScope();
+
+  // Returns the elapsed time so far.
+  uint64_t Elapsed() const;
+
+ private:
+  XWalkExtensionStats* stats_;
+  const char* event_;
+  uint64_t start_us_;
+};
+
+}  // namespace extensions
+
+#endif  // XWALK_EXTENSIONS_XWALK_EXTENSION_METRICS_H_
@@ -0,0 +1,71 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "extensions/common/xwalk_extension_privileges.h"
+
+#include <string>
+
+#include "common/app_policy.h"
+#include "common/application_data.h"
+#include "common/logger.h"
+
+namespace extensions {
+
+XWalkExtensionPrivileges::XWalkExtensionPrivileges() {
+  for (size_t i = 0; i < kMaxPrivileges / 64; ++i) {
+    granted_[i] = 0;
+  }
+}
+
+XWalkExtensionPrivileges::~XWalkExtensionPrivileges() {
+}
+
+// static
+XWalkExtensionPrivileges* XWalkExtensionPrivileges::GetInstance() {
+  static XWalkExtensionPrivileges self;
+  return &self;
+}
+
+void XWalkExtensionPrivileges::Initialize(
+    const common::ApplicationData* app_data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  policy_ = app_data->policy();
+
+  // The privileges registered before are evaluated again.
+  for (auto it = indexes_.begin(); it != indexes_.end(); ++it) {
+    UpdateBit(it->second, HasPrivilege(it->first));
+  }
+}
+
+size_t XWalkExtensionPrivileges::GetIndex(const std::string& privilege) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = indexes_.find(privilege);
+  if (it != indexes_.end())
+    return it->second;
+
+  size_t index = indexes_.size();
+  if (index >= kMaxPrivileges) {
+    LOGGER(ERROR) << "Too many privileges, '" << privilege
+                  << "' is never granted.";
+    return kInvalidIndex;
+  }
+  UpdateBit(index, HasPrivilege(privilege));
+  indexes_[privilege] = index;
+  return index;
+}
+
+bool XWalkExtensionPrivileges::HasPrivilege(
+    const std::string& privilege) const {
+  return policy_ && policy_->HasPrivilege(privilege);
+}
+
+void XWalkExtensionPrivileges::UpdateBit(size_t index, bool granted) {
+  uint64_t mask = UINT64_C(1) << (index % 64);
+  if (granted)
+    granted_[index / 64].fetch_or(mask, std::memory_order_relaxed);
+  else
+    granted_[index / 64].fetch_and(~mask, std::memory_order_relaxed);
+}
+
+}  // namespace extensions
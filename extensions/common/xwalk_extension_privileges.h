@@ -0,0 +1,62 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_XWALK_EXTENSION_PRIVILEGES_H_
+#define XWALK_EXTENSIONS_XWALK_EXTENSION_PRIVILEGES_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace common {
+class AppPolicy;
+class ApplicationData;
+}  // namespace common
+
+namespace extensions {
+
+// The privileges granted to the application, as a bitset indexed by the
+// privileges which the permission tables of the extensions refer to.
+// A privilege gets its index when it is first registered, so the access
+// checks of the extensions only test a bit.
+class XWalkExtensionPrivileges {
+ public:
+  static const size_t kMaxPrivileges = 1024;
+  static const size_t kInvalidIndex = static_cast<size_t>(-1);
+
+  static XWalkExtensionPrivileges* GetInstance();
+
+  // Takes the privileges of the application from its policy.
+  void Initialize(const common::ApplicationData* app_data);
+
+  // Returns the index of |privilege|, or kInvalidIndex if there are too many
+  // privileges.
+  size_t GetIndex(const std::string& privilege);
+
+  bool IsGranted(size_t index) const {
+    return index < kMaxPrivileges &&
+           (granted_[index / 64].load(std::memory_order_relaxed) &
+            (UINT64_C(1) << (index % 64))) != 0;
+  }
+
+ private:
+  XWalkExtensionPrivileges();
+  virtual ~XWalkExtensionPrivileges();
+
+  bool HasPrivilege(const std::string& privilege) const;
+  void UpdateBit(size_t index, bool granted);
+
+  std::mutex mutex_;
+  std::shared_ptr<const common::AppPolicy> policy_;
+  std::unordered_map<std::string, size_t> indexes_;
+  std::atomic<uint64_t> granted_[kMaxPrivileges / 64];
+};
+
+}  // namespace extensions
+
+#endif  // XWALK_EXTENSIONS_XWALK_EXTENSION_PRIVILEGES_H_
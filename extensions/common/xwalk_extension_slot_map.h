@@ -0,0 +1,124 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_XWALK_EXTENSION_SLOT_MAP_H_
+#define XWALK_EXTENSIONS_XWALK_EXTENSION_SLOT_MAP_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace extensions {
+
+// Maps the XW_Extension and XW_Instance handles to their objects with a
+// dense array of slots. A handle is made of the index of its slot and the
+// generation of the slot, so a lookup is an array access, and a stale handle
+// of a released slot is detected when the slot is reused.
+template <typename Handle, typename T>
+class XWalkExtensionSlotMap {
+ public:
+  XWalkExtensionSlotMap() {}
+
+  // Reserves a slot and returns its handle. The handle is never 0.
+  Handle Allocate() {
+    uint32_t index;
+    if (!free_slots_.empty()) {
+      index = free_slots_.back();
+      free_slots_.pop_back();
+    } else {
+      index = static_cast<uint32_t>(slots_.size());
+      if (index > kIndexMask)
+        return 0;
+      slots_.push_back(Slot());
+    }
+    Slot& slot = slots_[index];
+    slot.allocated = true;
+    slot.value = nullptr;
+    return MakeHandle(index, slot.generation);
+  }
+
+  // Binds |value| to an allocated |handle|. Returns false if the handle is
+  // stale or is already bound.
+  bool Set(Handle handle, T* value) {
+    Slot* slot = GetSlot(handle);
+    if (!slot || slot->value)
+      return false;
+    slot->value = value;
+    return true;
+  }
+
+  // Returns the value bound to |handle| or null if the handle is stale.
+  T* Get(Handle handle) const {
+    const Slot* slot = GetSlot(handle);
+    return slot ? slot->value : nullptr;
+  }
+
+  // Releases the slot of |handle|. The handle and all of its copies become
+  // stale. Returns false if the handle was already stale.
+  bool Release(Handle handle) {
+    Slot* slot = GetSlot(handle);
+    if (!slot)
+      return false;
+    uint32_t index = IndexOf(handle);
+    slot->allocated = false;
+    slot->value = nullptr;
+    slot->generation = (slot->generation + 1) & kGenerationMask;
+    if (slot->generation == 0)
+      slot->generation = 1;
+    free_slots_.push_back(index);
+    return true;
+  }
+
+ private:
+  // The handles are positive int32_t values.
+  static const int kIndexBits = 20;
+  static const uint32_t kIndexMask = (1u << kIndexBits) - 1;
+  static const uint32_t kGenerationMask = (1u << (31 - kIndexBits)) - 1;
+
+  struct Slot {
+    Slot() : generation(1), allocated(false), value(nullptr) {}
+    uint32_t generation;
+    bool allocated;
+    T* value;
+  };
+
+  static Handle MakeHandle(uint32_t index, uint32_t generation) {
+    return static_cast<Handle>((generation << kIndexBits) | index);
+  }
+
+  static uint32_t IndexOf(Handle handle) {
+    return static_cast<uint32_t>(handle) & kIndexMask;
+  }
+
+  static uint32_t GenerationOf(Handle handle) {
+    return (static_cast<uint32_t>(handle) >> kIndexBits) & kGenerationMask;
+  }
+
+  const Slot* GetSlot(Handle handle) const {
+    if (handle <= 0)
+      return nullptr;
+    uint32_t index = IndexOf(handle);
+    if (index >= slots_.size())
+      return nullptr;
+    const Slot& slot = slots_[index];
+    if (!slot.allocated || slot.generation != GenerationOf(handle))
+      return nullptr;
+    return &slot;
+  }
+
+  Slot* GetSlot(Handle handle) {
+    return const_cast<Slot*>(
+        static_cast<const XWalkExtensionSlotMap*>(this)->GetSlot(handle));
+  }
+
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+
+  XWalkExtensionSlotMap(const XWalkExtensionSlotMap&) = delete;
+  XWalkExtensionSlotMap& operator=(const XWalkExtensionSlotMap&) = delete;
+};
+
+}  // namespace extensions
+
+#endif  // XWALK_EXTENSIONS_XWALK_EXTENSION_SLOT_MAP_H_
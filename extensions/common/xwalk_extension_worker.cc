@@ -0,0 +1,77 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "extensions/common/xwalk_extension_worker.h"
+
+#include <pthread.h>
+
+#include <future>
+#include <string>
+
+namespace extensions {
+
+namespace {
+
+// Linux limits the thread names to 15 characters.
+const size_t kMaxThreadNameLength = 15;
+
+}  // namespace
+
+XWalkExtensionWorker::XWalkExtensionWorker(const std::string& name)
+    : stopping_(false),
+      thread_(&XWalkExtensionWorker::Run, this) {
+  pthread_setname_np(thread_.native_handle(),
+                     name.substr(0, kMaxThreadNameLength).c_str());
+}
+
+XWalkExtensionWorker::~XWalkExtensionWorker() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_one();
+  thread_.join();
+}
+
+void XWalkExtensionWorker::PostTask(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(task);
+  }
+  condition_.notify_one();
+}
+
+void XWalkExtensionWorker::RunTaskAndWait(Task task) {
+  // The task would wait for itself on the worker.
+  if (std::this_thread::get_id() == thread_.get_id()) {
+    task();
+    return;
+  }
+
+  std::promise<void> done;
+  PostTask([&task, &done]() {
+    task();
+    done.set_value();
+  });
+  done.get_future().wait();
+}
+
+void XWalkExtensionWorker::Run() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this]() {
+        return stopping_ || !tasks_.empty();
+      });
+      if (tasks_.empty())
+        return;
+      task = tasks_.front();
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace extensions
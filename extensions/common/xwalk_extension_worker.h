@@ -0,0 +1,46 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_XWALK_EXTENSION_WORKER_H_
+#define XWALK_EXTENSIONS_XWALK_EXTENSION_WORKER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace extensions {
+
+// A dedicated thread which runs the callbacks of an extension declaring
+// "worker_thread": true in its metadata. The tasks run one by one in the
+// order they were posted, so the extension still sees its callbacks
+// serialized, just not on the main thread.
+class XWalkExtensionWorker {
+ public:
+  typedef std::function<void()> Task;
+
+  explicit XWalkExtensionWorker(const std::string& name);
+  // Runs the remaining tasks and joins the thread.
+  ~XWalkExtensionWorker();
+
+  void PostTask(Task task);
+
+  // Runs |task| on the worker and blocks until it is done.
+  void RunTaskAndWait(Task task);
+
+ private:
+  void Run();
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<Task> tasks_;
+  bool stopping_;
+  std::thread thread_;
+};
+
+}  // namespace extensions
+
+#endif  // XWALK_EXTENSIONS_XWALK_EXTENSION_WORKER_H_
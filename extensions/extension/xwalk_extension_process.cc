@@ -0,0 +1,58 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <Ecore.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "common/application_data.h"
+#include "common/logger.h"
+#include "extensions/common/constants.h"
+#include "extensions/common/xwalk_extension_adapter.h"
+#include "extensions/common/xwalk_extension_metrics.h"
+#include "extensions/common/xwalk_extension_privileges.h"
+#include "extensions/extension/xwalk_extension_server.h"
+
+// The shared extension host of an application. It is launched by the runtime
+// with the application id, and serves the extensions to the renderers of the
+// application on the D-Bus socket "<app_id>.Extension". The runtime may pass
+// a pipe as the second argument, which is closed once the socket is ready.
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    LOGGER(ERROR) << "Application id is not given.";
+    return EXIT_FAILURE;
+  }
+  std::string app_id(argv[1]);
+  int ready_fd = argc > 2 ? atoi(argv[2]) : -1;
+
+  ecore_init();
+  // GDBus dispatches the method calls on the glib main context.
+  ecore_main_loop_glib_integrate();
+
+  LOGGER(INFO) << "Extension host process has been created for " << app_id;
+  {
+    // The permission tables are checked against the privileges of the
+    // application.
+    common::ApplicationData app_data(app_id);
+    if (app_data.LoadManifestData()) {
+      extensions::XWalkExtensionPrivileges::GetInstance()->Initialize(
+          &app_data);
+    }
+
+    extensions::XWalkExtensionAdapter::GetInstance()->AttachMessageLoop();
+    extensions::XWalkExtensionServer server;
+    server.Start(app_id + "." + extensions::kDBusNameForExtension);
+    if (ready_fd >= 0) {
+      close(ready_fd);
+    }
+    ecore_main_loop_begin();
+  }
+  extensions::XWalkExtensionMetrics::GetInstance()->Dump();
+  extensions::XWalkExtensionAdapter::GetInstance()->DetachMessageLoop();
+
+  ecore_shutdown();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,423 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "extensions/extension/xwalk_extension_server.h"
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <functional>
+#include <string>
+
+#include "common/dbus_payload.h"
+#include "common/logger.h"
+#include "common/profiler.h"
+#include "extensions/common/constants.h"
+#include "extensions/common/xwalk_extension.h"
+#include "extensions/common/xwalk_extension_metrics.h"
+
+namespace extensions {
+
+namespace {
+
+const char kDBusIntrospectionXML[] =
+  "<node>"
+  "  <interface name='org.tizen.xwalk.Extension'>"
+  "    <method name='GetExtensions'>"
+  "      <arg name='extensions' type='a(sas)' direction='out' />"
+  "    </method>"
+  "    <method name='GetJavascriptCode'>"
+  "      <arg name='extension_name' type='s' direction='in' />"
+  "      <arg name='code' type='s' direction='out' />"
+  "    </method>"
+  "    <method name='GetMetrics'>"
+  "      <arg name='metrics' type='s' direction='out' />"
+  "    </method>"
+  "    <method name='CreateInstance'>"
+  "      <arg name='instance_id' type='s' direction='in' />"
+  "      <arg name='extension_name' type='s' direction='in' />"
+  "    </method>"
+  "    <method name='DestroyInstance'>"
+  "      <arg name='instance_id' type='s' direction='in' />"
+  "    </method>"
+  "    <method name='PostMessage'>"
+  "      <arg name='instance_id' type='s' direction='in' />"
+  "      <arg name='msg' type='v' direction='in' />"
+  "    </method>"
+  "    <method name='PostBinaryMessage'>"
+  "      <arg name='instance_id' type='s' direction='in' />"
+  "      <arg name='data' type='v' direction='in' />"
+  "    </method>"
+  "    <method name='SendSyncMessage'>"
+  "      <arg name='instance_id' type='s' direction='in' />"
+  "      <arg name='msg' type='s' direction='in' />"
+  "      <arg name='reply' type='s' direction='out' />"
+  "    </method>"
+  "    <method name='SendAsyncMessage'>"
+  "      <arg name='instance_id' type='s' direction='in' />"
+  "      <arg name='request_id' type='i' direction='in' />"
+  "      <arg name='msg' type='s' direction='in' />"
+  "    </method>"
+  "    <signal name='OnMessageToJS'>"
+  "      <arg name='instance_id' type='s' />"
+  "      <arg name='msg' type='v' />"
+  "    </signal>"
+  "    <signal name='OnBinaryMessageToJS'>"
+  "      <arg name='instance_id' type='s' />"
+  "      <arg name='data' type='v' />"
+  "    </signal>"
+  "    <signal name='OnAsyncReplyToJS'>"
+  "      <arg name='instance_id' type='s' />"
+  "      <arg name='request_id' type='i' />"
+  "      <arg name='reply' type='s' />"
+  "    </signal>"
+  "  </interface>"
+  "</node>";
+
+}  // namespace
+
+XWalkExtensionServer::XWalkExtensionServer() {
+}
+
+XWalkExtensionServer::~XWalkExtensionServer() {
+  for (auto it = instances_.begin(); it != instances_.end(); ++it) {
+    XWalkExtensionInstance* instance = it->second.instance;
+    instance->extension()->ReleaseInstance(instance);
+  }
+  instances_.clear();
+}
+
+void XWalkExtensionServer::Start(const std::string& name) {
+  SCOPE_PROFILE();
+  manager_.LoadExtensions(true, true);
+
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  using std::placeholders::_3;
+  using std::placeholders::_4;
+  dbus_server_.SetIntrospectionXML(kDBusIntrospectionXML);
+  dbus_server_.SetMethodCallback(
+      kDBusInterfaceNameForExtension,
+      std::bind(&XWalkExtensionServer::HandleMethodCall, this, _1, _2, _3, _4));
+  dbus_server_.SetDisconnectedCallback(
+      std::bind(&XWalkExtensionServer::HandleDisconnected, this, _1));
+  dbus_server_.SetPeerCredentialsCallback(
+      std::bind(&XWalkExtensionServer::HandlePeerCredentials, this, _1));
+  dbus_server_.Start(name);
+}
+
+bool XWalkExtensionServer::HandlePeerCredentials(GCredentials* credentials) {
+  if (!credentials) {
+    LOGGER(ERROR) << "No peer credentials";
+    return false;
+  }
+
+  // The plugins run with the privileges of the application, so only the
+  // processes of the same user and the same Smack label may use them.
+  uid_t uid = g_credentials_get_unix_user(credentials, NULL);
+  if (uid != getuid()) {
+    LOGGER(ERROR) << "Peer uid " << uid << " is not allowed";
+    return false;
+  }
+
+  pid_t pid = g_credentials_get_unix_pid(credentials, NULL);
+  if (pid <= 0) {
+    LOGGER(ERROR) << "No peer pid";
+    return false;
+  }
+  std::string self_label = ReadSmackLabel("/proc/self/attr/current");
+  if (self_label.empty()) {
+    // Smack is not enabled.
+    return true;
+  }
+  std::string peer_label =
+      ReadSmackLabel("/proc/" + std::to_string(pid) + "/attr/current");
+  if (peer_label != self_label) {
+    LOGGER(ERROR) << "Peer label '" << peer_label << "' is not allowed";
+    return false;
+  }
+  return true;
+}
+
+void XWalkExtensionServer::HandleMethodCall(
+    GDBusConnection* connection, const std::string& method_name,
+    GVariant* parameters, GDBusMethodInvocation* invocation) {
+  if (method_name == kMethodGetExtensions) {
+    HandleGetExtensions(invocation);
+  } else if (method_name == kMethodGetJavascriptCode) {
+    HandleGetJavascriptCode(parameters, invocation);
+  } else if (method_name == kMethodGetMetrics) {
+    HandleGetMetrics(invocation);
+  } else if (method_name == kMethodCreateInstance) {
+    HandleCreateInstance(connection, parameters, invocation);
+  } else if (method_name == kMethodDestroyInstance) {
+    HandleDestroyInstance(connection, parameters, invocation);
+  } else if (method_name == kMethodPostMessage) {
+    HandlePostMessage(connection, parameters, invocation);
+  } else if (method_name == kMethodPostBinaryMessage) {
+    HandlePostBinaryMessage(connection, parameters, invocation);
+  } else if (method_name == kMethodSendSyncMessage) {
+    HandleSendSyncMessage(connection, parameters, invocation);
+  } else if (method_name == kMethodSendAsyncMessage) {
+    HandleSendAsyncMessage(connection, parameters, invocation);
+  } else {
+    LOGGER(ERROR) << "Unknown method '" << method_name << "'";
+    g_dbus_method_invocation_return_value(invocation, NULL);
+  }
+}
+
+void XWalkExtensionServer::HandleDisconnected(GDBusConnection* connection) {
+  // The renderer has gone, so the instances of its frames are released.
+  for (auto it = instances_.begin(); it != instances_.end(); ) {
+    if (it->second.connection == connection) {
+      XWalkExtensionInstance* instance = it->second.instance;
+      instance->extension()->ReleaseInstance(instance);
+      it = instances_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void XWalkExtensionServer::HandleGetExtensions(
+    GDBusMethodInvocation* invocation) {
+  GVariantBuilder builder;
+  g_variant_builder_init(&builder, G_VARIANT_TYPE("a(sas)"));
+
+  XWalkExtensionManager::ExtensionMap extensions = manager_.extensions();
+  for (auto it = extensions.begin(); it != extensions.end(); ++it) {
+    g_variant_builder_open(&builder, G_VARIANT_TYPE("(sas)"));
+    g_variant_builder_add(&builder, "s", it->first.c_str());
+    g_variant_builder_open(&builder, G_VARIANT_TYPE("as"));
+    XWalkExtension::StringVector entry_points = it->second->entry_points();
+    for (auto ep = entry_points.begin(); ep != entry_points.end(); ++ep) {
+      g_variant_builder_add(&builder, "s", ep->c_str());
+    }
+    g_variant_builder_close(&builder);
+    g_variant_builder_close(&builder);
+  }
+
+  g_dbus_method_invocation_return_value(
+      invocation, g_variant_new("(a(sas))", &builder));
+}
+
+void XWalkExtensionServer::HandleGetMetrics(
+    GDBusMethodInvocation* invocation) {
+  // The renderer writes the metrics of the host along with its own.
+  std::string metrics;
+  if (XWalkExtensionMetrics::enabled()) {
+    metrics = XWalkExtensionMetrics::GetInstance()->GetJSON();
+  }
+  g_dbus_method_invocation_return_value(
+      invocation, g_variant_new("(s)", metrics.c_str()));
+}
+
+void XWalkExtensionServer::HandleGetJavascriptCode(
+    GVariant* parameters, GDBusMethodInvocation* invocation) {
+  const gchar* extension_name;
+  g_variant_get(parameters, "(&s)", &extension_name);
+
+  std::string code;
+  XWalkExtensionManager::ExtensionMap extensions = manager_.extensions();
+  auto it = extensions.find(extension_name);
+  if (it == extensions.end()) {
+    LOGGER(ERROR) << "No such extension '" << extension_name << "'";
+  } else {
+    code = it->second->GetJavascriptCode();
+  }
+
+  g_dbus_method_invocation_return_value(
+      invocation, g_variant_new("(s)", code.c_str()));
+}
+
+void XWalkExtensionServer::HandleCreateInstance(
+    GDBusConnection* connection, GVariant* parameters,
+    GDBusMethodInvocation* invocation) {
+  const gchar* instance_id;
+  const gchar* extension_name;
+  g_variant_get(parameters, "(&s&s)", &instance_id, &extension_name);
+  std::string id(instance_id);
+  std::string name(extension_name);
+  // The strings are owned by the invocation.
+  g_dbus_method_invocation_return_value(invocation, NULL);
+
+  if (instances_.find(id) != instances_.end()) {
+    LOGGER(ERROR) << "Instance '" << id << "' already exists";
+    return;
+  }
+
+  // find extension with given the extension name
+  XWalkExtensionManager::ExtensionMap extensions = manager_.extensions();
+  auto it = extensions.find(name);
+  if (it == extensions.end()) {
+    LOGGER(ERROR) << "No such extension '" << name << "'";
+    return;
+  }
+
+  // create instance
+  XWalkExtensionInstance* instance = it->second->CreateInstance();
+  if (!instance) {
+    LOGGER(ERROR) << "Failed to create instance of extension '"
+                  << name << "'";
+    return;
+  }
+
+  // set callbacks, the messages are sent as signals to the renderer
+  // which owns the instance.
+  common::DBusServer* server = &dbus_server_;
+  auto send_payload = [server, connection, id](const char* signal,
+                                               const void* data,
+                                               size_t size) {
+    GUnixFDList* fd_list = common::DBusPayload::NewFDList(connection);
+    GVariant* payload = common::DBusPayload::Pack(data, size, fd_list);
+    server->SendSignal(connection, kDBusInterfaceNameForExtension, signal,
+                       g_variant_new("(s@v)", id.c_str(), payload), fd_list);
+    if (fd_list) {
+      g_object_unref(fd_list);
+    }
+  };
+  instance->SetPostMessageCallback(
+      [send_payload](const std::string& msg) {
+    send_payload(kSignalOnMessageToJS, msg.data(), msg.size());
+  });
+  instance->SetPostBinaryMessageCallback(
+      [send_payload](const void* data, size_t size) {
+    send_payload(kSignalOnBinaryMessageToJS, data, size);
+  });
+  instance->SetAsyncReplyCallback(
+      [server, connection, id](int32_t request_id, const std::string& reply) {
+    server->SendSignal(connection, kDBusInterfaceNameForExtension,
+                       kSignalOnAsyncReplyToJS,
+                       g_variant_new("(sis)", id.c_str(), request_id,
+                                     reply.c_str()));
+  });
+
+  InstanceEntry entry = { connection, instance };
+  instances_[id] = entry;
+}
+
+void XWalkExtensionServer::HandleDestroyInstance(
+    GDBusConnection* connection, GVariant* parameters,
+    GDBusMethodInvocation* invocation) {
+  const gchar* instance_id;
+  g_variant_get(parameters, "(&s)", &instance_id);
+
+  // find instance with the given instance id
+  auto it = instances_.find(instance_id);
+  if (it == instances_.end() || it->second.connection != connection) {
+    LOGGER(ERROR) << "No such instance '" << instance_id << "'";
+  } else {
+    // destroy the instance, or keep it for the next page
+    XWalkExtensionInstance* instance = it->second.instance;
+    instance->extension()->ReleaseInstance(instance);
+    instances_.erase(it);
+  }
+  g_dbus_method_invocation_return_value(invocation, NULL);
+}
+
+void XWalkExtensionServer::HandlePostMessage(
+    GDBusConnection* connection, GVariant* parameters,
+    GDBusMethodInvocation* invocation) {
+  const gchar* instance_id;
+  GVariant* payload;
+  g_variant_get(parameters, "(&s@v)", &instance_id, &payload);
+
+  XWalkExtensionInstance* instance = GetInstance(connection, instance_id);
+  if (instance) {
+    common::DBusPayload::Unpack(payload, GetFDList(invocation),
+        [instance](const void* data, size_t size) {
+      instance->HandleMessage(
+          std::string(static_cast<const char*>(data), size));
+    });
+  }
+  g_variant_unref(payload);
+  g_dbus_method_invocation_return_value(invocation, NULL);
+}
+
+void XWalkExtensionServer::HandlePostBinaryMessage(
+    GDBusConnection* connection, GVariant* parameters,
+    GDBusMethodInvocation* invocation) {
+  const gchar* instance_id;
+  GVariant* payload;
+  g_variant_get(parameters, "(&s@v)", &instance_id, &payload);
+
+  XWalkExtensionInstance* instance = GetInstance(connection, instance_id);
+  if (instance) {
+    common::DBusPayload::Unpack(payload, GetFDList(invocation),
+        [instance](const void* data, size_t size) {
+      instance->HandleBinaryMessage(data, size);
+    });
+  }
+  g_variant_unref(payload);
+  g_dbus_method_invocation_return_value(invocation, NULL);
+}
+
+void XWalkExtensionServer::HandleSendSyncMessage(
+    GDBusConnection* connection, GVariant* parameters,
+    GDBusMethodInvocation* invocation) {
+  const gchar* instance_id;
+  const gchar* msg;
+  g_variant_get(parameters, "(&s&s)", &instance_id, &msg);
+
+  // Post a message and receive a reply message
+  std::string reply;
+  XWalkExtensionInstance* instance = GetInstance(connection, instance_id);
+  if (instance) {
+    instance->SetSendSyncReplyCallback([&reply](const std::string& msg) {
+      reply = msg;
+    });
+    instance->HandleSyncMessage(msg);
+    // A late SetSyncReply() must not write to |reply| any more.
+    instance->SetSendSyncReplyCallback(nullptr);
+  }
+
+  g_dbus_method_invocation_return_value(
+      invocation, g_variant_new("(s)", reply.c_str()));
+}
+
+void XWalkExtensionServer::HandleSendAsyncMessage(
+    GDBusConnection* connection, GVariant* parameters,
+    GDBusMethodInvocation* invocation) {
+  const gchar* instance_id;
+  gint32 request_id;
+  const gchar* msg;
+  g_variant_get(parameters, "(&si&s)", &instance_id, &request_id, &msg);
+
+  // The reply is sent back as a signal
+  XWalkExtensionInstance* instance = GetInstance(connection, instance_id);
+  if (instance) {
+    instance->HandleAsyncMessage(request_id, msg);
+  }
+  g_dbus_method_invocation_return_value(invocation, NULL);
+}
+
+// static
+std::string XWalkExtensionServer::ReadSmackLabel(const std::string& path) {
+  std::ifstream file(path);
+  std::string label;
+  std::getline(file, label);
+  // The label may be terminated with a null character.
+  return std::string(label.c_str());
+}
+
+// static
+GUnixFDList* XWalkExtensionServer::GetFDList(
+    GDBusMethodInvocation* invocation) {
+  return g_dbus_message_get_unix_fd_list(
+      g_dbus_method_invocation_get_message(invocation));
+}
+
+XWalkExtensionInstance* XWalkExtensionServer::GetInstance(
+    GDBusConnection* connection, const std::string& instance_id) {
+  // Only the renderer which created the instance can drive it.
+  auto it = instances_.find(instance_id);
+  if (it == instances_.end() || it->second.connection != connection) {
+    LOGGER(ERROR) << "No such instance '" << instance_id << "'";
+    return NULL;
+  }
+  return it->second.instance;
+}
+
+}  // namespace extensions
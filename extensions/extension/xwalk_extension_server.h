@@ -0,0 +1,84 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_EXTENSION_XWALK_EXTENSION_SERVER_H_
+#define XWALK_EXTENSIONS_EXTENSION_XWALK_EXTENSION_SERVER_H_
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include <map>
+#include <string>
+
+#include "common/dbus_server.h"
+#include "extensions/common/xwalk_extension_instance.h"
+#include "extensions/common/xwalk_extension_manager.h"
+
+namespace extensions {
+
+// Loads every extension once in the extension host process and serves their
+// instances to all the renderers of the application over the private D-Bus
+// socket. Each renderer connection owns the instances it creates, and they
+// are destroyed when the renderer goes away.
+class XWalkExtensionServer {
+ public:
+  XWalkExtensionServer();
+  virtual ~XWalkExtensionServer();
+
+  void Start(const std::string& name);
+
+ private:
+  struct InstanceEntry {
+    GDBusConnection* connection;
+    XWalkExtensionInstance* instance;
+  };
+  typedef std::map<std::string, InstanceEntry> InstanceMap;
+
+  void HandleMethodCall(GDBusConnection* connection,
+                        const std::string& method_name,
+                        GVariant* parameters,
+                        GDBusMethodInvocation* invocation);
+  void HandleDisconnected(GDBusConnection* connection);
+
+  void HandleGetExtensions(GDBusMethodInvocation* invocation);
+  void HandleGetMetrics(GDBusMethodInvocation* invocation);
+  void HandleGetJavascriptCode(GVariant* parameters,
+                               GDBusMethodInvocation* invocation);
+  void HandleCreateInstance(GDBusConnection* connection,
+                            GVariant* parameters,
+                            GDBusMethodInvocation* invocation);
+  void HandleDestroyInstance(GDBusConnection* connection,
+                             GVariant* parameters,
+                             GDBusMethodInvocation* invocation);
+  void HandlePostMessage(GDBusConnection* connection,
+                         GVariant* parameters,
+                         GDBusMethodInvocation* invocation);
+  void HandlePostBinaryMessage(GDBusConnection* connection,
+                               GVariant* parameters,
+                               GDBusMethodInvocation* invocation);
+  void HandleSendSyncMessage(GDBusConnection* connection,
+                             GVariant* parameters,
+                             GDBusMethodInvocation* invocation);
+  void HandleSendAsyncMessage(GDBusConnection* connection,
+                              GVariant* parameters,
+                              GDBusMethodInvocation* invocation);
+  // Allows only the renderers of this application to connect.
+  bool HandlePeerCredentials(GCredentials* credentials);
+
+  // Returns the instance only if it was created by |connection|.
+  XWalkExtensionInstance* GetInstance(GDBusConnection* connection,
+                                      const std::string& instance_id);
+  // Returns the first line of |path| which holds a Smack label.
+  static std::string ReadSmackLabel(const std::string& path);
+  // Returns the descriptors passed with the method call, or NULL.
+  static GUnixFDList* GetFDList(GDBusMethodInvocation* invocation);
+
+  common::DBusServer dbus_server_;
+  XWalkExtensionManager manager_;
+  InstanceMap instances_;
+};
+
+}  // namespace extensions
+
+#endif  // XWALK_EXTENSIONS_EXTENSION_XWALK_EXTENSION_SERVER_H_
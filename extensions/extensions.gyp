@@ -4,7 +4,7 @@
   ],
   'targets': [
     {
-      'target_name': 'xwalk_extension_renderer',
+      'target_name': 'xwalk_extension_common',
       'type': 'static_library',
       'dependencies': [
         '../common/common.gyp:xwalk_tizen_common',
@@ -18,12 +18,42 @@
         'common/xwalk_extension_instance.cc',
         'common/xwalk_extension_adapter.h',
         'common/xwalk_extension_adapter.cc',
+        'common/xwalk_extension_index.h',
+        'common/xwalk_extension_index.cc',
+        'common/xwalk_extension_message_queue.h',
+        'common/xwalk_extension_message_queue.cc',
+        'common/xwalk_extension_metrics.h',
+        'common/xwalk_extension_metrics.cc',
+        'common/xwalk_extension_privileges.h',
+        'common/xwalk_extension_privileges.cc',
         'common/xwalk_extension_manager.h',
         'common/xwalk_extension_manager.cc',
+        'common/xwalk_extension_slot_map.h',
+        'common/xwalk_extension_worker.h',
+        'common/xwalk_extension_worker.cc',
+      ],
+      'variables': {
+        'packages': [
+          'ecore',
+        ],
+      },
+    }, # end of target 'xwalk_extension_common'
+    {
+      'target_name': 'xwalk_extension_renderer',
+      'type': 'static_library',
+      'dependencies': [
+        '../common/common.gyp:xwalk_tizen_common',
+        'xwalk_extension_common',
+      ],
+      'sources': [
         'renderer/xwalk_extension_client.h',
         'renderer/xwalk_extension_client.cc',
         'renderer/xwalk_extension_module.h',
         'renderer/xwalk_extension_module.cc',
+        'renderer/xwalk_extension_code_cache.h',
+        'renderer/xwalk_extension_code_cache.cc',
+        'renderer/xwalk_extension_injection_policy.h',
+        'renderer/xwalk_extension_injection_policy.cc',
         'renderer/xwalk_extension_renderer_controller.h',
         'renderer/xwalk_extension_renderer_controller.cc',
         'renderer/xwalk_module_system.h',
@@ -44,6 +74,24 @@
         ],
       },
     }, # end of target 'xwalk_extension_renderer'
+    {
+      'target_name': 'xwalk_extension',
+      'type': 'executable',
+      'dependencies': [
+        '../common/common.gyp:xwalk_tizen_common',
+        'xwalk_extension_common',
+      ],
+      'sources': [
+        'extension/xwalk_extension_process.cc',
+        'extension/xwalk_extension_server.h',
+        'extension/xwalk_extension_server.cc',
+      ],
+      'variables': {
+        'packages': [
+          'ecore',
+        ],
+      },
+    }, # end of target 'xwalk_extension'
     {
       'target_name': 'widget_plugin',
       'type': 'shared_library',
@@ -54,6 +102,10 @@
         'internal/widget/widget_api.js',
         'internal/widget/widget_extension.cc',
       ],
+      'variables': {
+        # Must be the same as the name set by the extension.
+        'xwalk_js2c_extension_name': 'Widget',
+      },
       'copies': [
         {
           'destination': '<(SHARED_INTERMEDIATE_DIR)',
@@ -73,6 +125,10 @@
         'internal/splash_screen/splash_screen_api.js',
         'internal/splash_screen/splash_screen_extension.cc',
       ],
+      'variables': {
+        # Must be the same as the name set by the extension.
+        'xwalk_js2c_extension_name': 'SplashScreen',
+      },
       'copies': [
         {
           'destination': '<(SHARED_INTERMEDIATE_DIR)',
@@ -33,6 +33,7 @@ extern "C" {
 #define XW_EXPORT __declspec(dllexport)
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 
 
@@ -117,6 +118,14 @@ struct XW_CoreInterface_1 {
   // - extension.setMessageListener(): allow setting a callback that is called
   //                                   when the native code sends a message
   //                                   to JavaScript. Callback takes a string.
+  //                                   With {batch: true} as the second
+  //                                   argument, the callback takes an array
+  //                                   of the messages sent in one main loop
+  //                                   iteration.
+  //
+  // The functions of 'extension' are bound to it, so they can be passed
+  // around, e.g. as callbacks. Calling the unbound functions, which are
+  // shared by all the extensions, on another object throws a TypeError.
   //
   // This function should be called only during XW_Initialize().
   void (*SetJavaScriptAPI)(XW_Extension extension, const char* api);
@@ -154,7 +163,8 @@ typedef struct XW_CoreInterface_1 XW_CoreInterface;
 //
 
 #define XW_MESSAGING_INTERFACE_1 "XW_MessagingInterface_1"
-#define XW_MESSAGING_INTERFACE XW_MESSAGING_INTERFACE_1
+#define XW_MESSAGING_INTERFACE_2 "XW_MessagingInterface_2"
+#define XW_MESSAGING_INTERFACE XW_MESSAGING_INTERFACE_2
 
 typedef void (*XW_HandleMessageCallback)(XW_Instance instance,
                                          const char* message);
@@ -176,7 +186,38 @@ struct XW_MessagingInterface_1 {
   void (*PostMessage)(XW_Instance instance, const char* message);
 };
 
-typedef struct XW_MessagingInterface_1 XW_MessagingInterface;
+// XW_MessagingInterface_2 adds binary messages, which carry a buffer of
+// |size| bytes instead of a NUL-terminated string. In the JavaScript side, an
+// ArrayBuffer or a typed array passed to extension.postMessage() is delivered
+// to the binary message callback, and a binary message posted by the
+// extension is passed to the message listener as an ArrayBuffer.
+
+typedef void (*XW_HandleBinaryMessageCallback)(XW_Instance instance,
+                                               const void* data,
+                                               size_t size);
+
+struct XW_MessagingInterface_2 {
+  void (*Register)(XW_Extension extension,
+                   XW_HandleMessageCallback handle_message);
+  void (*PostMessage)(XW_Instance instance, const char* message);
+
+  // Register a callback to be called when the JavaScript code associated
+  // with the extension posts an ArrayBuffer or a typed array. |data| is valid
+  // only during the callback.
+  void (*RegisterBinaryMessageCallback)(
+      XW_Extension extension,
+      XW_HandleBinaryMessageCallback handle_binary_message);
+
+  // Post a binary message to the web content associated with the instance.
+  // The buffer is copied, so it can be released after the call returns.
+  //
+  // This function is thread-safe and can be called until the instance is
+  // destroyed.
+  void (*PostBinaryMessage)(XW_Instance instance, const void* data,
+                            size_t size);
+};
+
+typedef struct XW_MessagingInterface_2 XW_MessagingInterface;
 
 #ifdef __cplusplus
 }  // extern "C"
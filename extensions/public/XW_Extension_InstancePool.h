@@ -0,0 +1,54 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_INSTANCEPOOL_H_
+#define XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_INSTANCEPOOL_H_
+
+// NOTE: This file and interfaces marked as internal are not considered stable
+// and can be modified in incompatible ways between Crosswalk versions.
+
+#ifndef XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_H_
+#error "You should include XW_Extension.h before this file"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XW_INTERNAL_INSTANCE_POOL_INTERFACE_1 \
+  "XW_Internal_InstancePoolInterface_1"
+#define XW_INTERNAL_INSTANCE_POOL_INTERFACE \
+  XW_INTERNAL_INSTANCE_POOL_INTERFACE_1
+
+//
+// XW_INTERNAL_INSTANCE_POOL_INTERFACE: extensions declaring an
+// "instance_pool" in their metadata keep the instances released by a page
+// for the next pages, instead of destroying and creating them again.
+//
+// The reset callback is called when an instance is released to the pool.
+// The extension should drop the state which belongs to the page there, and
+// keep the expensive resources, e.g. platform handles. After the reset
+// callback the instance gets a new XW_Instance handle, and the messages and
+// replies posted with the old one are dropped. The instance data set by
+// SetInstanceData() is kept, so the extension should find its state from the
+// handle through GetInstanceData(). The destroyed instance callback is
+// called with the current handle when the instance leaves the pool for good.
+//
+
+typedef void (*XW_ResetInstanceCallback)(XW_Instance instance);
+
+struct XW_Internal_InstancePoolInterface_1 {
+  // This function should be called only during XW_Initialize().
+  void (*RegisterResetCallback)(XW_Extension extension,
+                                XW_ResetInstanceCallback reset);
+};
+
+typedef struct XW_Internal_InstancePoolInterface_1
+    XW_Internal_InstancePoolInterface;
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // XWALK_EXTENSIONS_PUBLIC_XW_EXTENSION_INSTANCEPOOL_H_
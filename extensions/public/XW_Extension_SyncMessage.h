@@ -41,6 +41,39 @@ struct XW_Internal_SyncMessagingInterface_1 {
 typedef struct XW_Internal_SyncMessagingInterface_1
     XW_Internal_SyncMessagingInterface;
 
+//
+// XW_INTERNAL_ASYNC_REPLY_INTERFACE: allow JavaScript code to send a request
+// with extension.sendAsyncMessage(), which returns a Promise instead of
+// blocking like sendSyncMessage(). The extension answers the request later
+// by calling SetReply with the request id it was given.
+//
+// Extensions which don't register the callback get the request through
+// their XW_HandleSyncMessageCallback, and the Promise is resolved with the
+// synchronous reply.
+//
+
+#define XW_INTERNAL_ASYNC_REPLY_INTERFACE_1 \
+  "XW_InternalAsyncReplyInterface_1"
+#define XW_INTERNAL_ASYNC_REPLY_INTERFACE \
+  XW_INTERNAL_ASYNC_REPLY_INTERFACE_1
+
+typedef void (*XW_HandleAsyncMessageCallback)(XW_Instance instance,
+                                              int32_t request_id,
+                                              const char* message);
+
+struct XW_Internal_AsyncReplyInterface_1 {
+  void (*Register)(XW_Extension extension,
+                   XW_HandleAsyncMessageCallback handle_async_message);
+
+  // Resolves the Promise of the request. This function is thread-safe and
+  // can be called until the instance is destroyed.
+  void (*SetReply)(XW_Instance instance, int32_t request_id,
+                   const char* reply);
+};
+
+typedef struct XW_Internal_AsyncReplyInterface_1
+    XW_Internal_AsyncReplyInterface;
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -25,6 +25,8 @@
 namespace extensions {
 
 namespace {
+// Creates the Object which the JavaScript APIs of the extensions use instead
+// of the one of the page, whose functions may have been replaced.
 const char *kCreateObjectCode =
     "(function(object) {"
     "  var newobject = Object.create(object);"
@@ -39,9 +41,7 @@ const char *kCreateObjectCode =
     "      newobject['origin_prototype'][name] = object.prototype[name];"
     "    }"
     "  });"
-    "  return function() {"
-    "    return newobject;"
-    "  };"
+    "  return newobject;"
     "}(Object));";
 
 v8::Handle<v8::Value> RunString(const std::string& code) {
@@ -73,41 +73,39 @@ v8::Handle<v8::Value> RunString(const std::string& code) {
 }  //  namespace
 
 
-ObjectToolsModule::ObjectToolsModule() {
+ObjectToolsModule::ObjectToolsModule(v8::Handle<v8::Object> object) {
+  // The Object is copied when the script context is created, before the
+  // scripts of the page run, so its functions are the original ones even if
+  // the module is installed later. It is shared by all the extensions of the
+  // context.
+  if (!object.IsEmpty()) {
+    object_.Reset(v8::Isolate::GetCurrent(), object);
+  }
+}
+
+// static
+v8::Handle<v8::Object> ObjectToolsModule::CreateObject() {
   v8::Isolate* isolate = v8::Isolate::GetCurrent();
-  v8::HandleScope handle_scope(isolate);
+  v8::EscapableHandleScope handle_scope(isolate);
 
   v8::Handle<v8::Value> result = RunString(kCreateObjectCode);
-  if (!result->IsFunction()) {
-    LOGGER(ERROR) << "Couldn't load Object Create function";
-    return;
+  if (!result->IsObject()) {
+    LOGGER(ERROR) << "Couldn't create Object";
+    return v8::Handle<v8::Object>();
   }
-  v8::Handle<v8::Function> create_function =
-      v8::Handle<v8::Function>::Cast(result);
-
-  create_function_.Reset(isolate, create_function);
+  return handle_scope.Escape(v8::Local<v8::Object>::Cast(result));
 }
 
 ObjectToolsModule::~ObjectToolsModule() {
-  create_function_.Reset();
+  object_.Reset();
 }
 
 v8::Handle<v8::Object> ObjectToolsModule::NewInstance() {
   v8::Isolate* isolate = v8::Isolate::GetCurrent();
-  if (create_function_.IsEmpty()) {
-    return v8::Object::New(isolate);
-  }
-  v8::Handle<v8::Function> function =
-      v8::Local<v8::Function>::New(isolate, create_function_);
-
-  v8::Handle<v8::Context> context = v8::Context::New(isolate);
-  v8::TryCatch try_catch;
-  v8::Handle<v8::Value> ret = function->Call(context->Global(), 0, NULL);
-  if (try_catch.HasCaught()) {
-    LOGGER(ERROR) << "Exception when running create function: ";
+  if (object_.IsEmpty()) {
     return v8::Object::New(isolate);
   }
-  return v8::Handle<v8::Object>::Cast(ret);
+  return v8::Local<v8::Object>::New(isolate, object_);
 }
 
 }  // namespace extensions
@@ -23,12 +23,17 @@ namespace extensions {
 
 class ObjectToolsModule : public XWalkNativeModule {
  public:
-  ObjectToolsModule();
+  // |object| is made by CreateObject() in the same context, or is empty.
+  explicit ObjectToolsModule(v8::Handle<v8::Object> object);
   ~ObjectToolsModule() override;
 
+  // Copies the Object of the current context, so it must be called when the
+  // context is created. Returns an empty handle on failure.
+  static v8::Handle<v8::Object> CreateObject();
+
  private:
   v8::Handle<v8::Object> NewInstance() override;
-  v8::Persistent<v8::Function> create_function_;
+  v8::Persistent<v8::Object> object_;
 };
 
 }  // namespace extensions
@@ -60,7 +60,10 @@ void DispatchEvent(const v8::Local<v8::Object>& This,
     return;
   }
 
-  v8::Handle<v8::Context> context = v8::Context::New(isolate);
+  // The handler is called on the global object of the page which owns the
+  // preference object.
+  v8::Handle<v8::Context> context = This->CreationContext();
+  v8::Context::Scope context_scope(context);
 
   const int argc = 3;
   v8::Handle<v8::Value> argv[argc] = {
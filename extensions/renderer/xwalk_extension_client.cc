@@ -7,50 +7,368 @@
 
 #include <gio/gio.h>
 #include <glib.h>
+#include <stdlib.h>
 #include <unistd.h>
 
+#include <functional>
+#include <list>
 #include <string>
+#include <vector>
 
+#include "common/app_db.h"
+#include "common/constants.h"
+#include "common/dbus_payload.h"
+#include "common/file_utils.h"
 #include "common/logger.h"
+#include "common/picojson.h"
 #include "common/profiler.h"
 #include "common/string_utils.h"
 #include "extensions/common/constants.h"
+#include "extensions/common/xwalk_extension_metrics.h"
 
 namespace extensions {
 
-XWalkExtensionClient::XWalkExtensionClient() {
+namespace {
+
+const char kAppDBExtensionUsageSection[] = "ExtensionUsage";
+
+// Interval of checking the idle extensions, and the time after which an
+// extension without instances is unloaded, in seconds.
+const double kIdleCheckInterval = 60.0;
+const double kIdleUnloadTime = 300.0;
+
+}  // namespace
+
+XWalkExtensionClient::XWalkExtensionClient()
+    : idle_timer_(NULL) {
 }
 
 XWalkExtensionClient::~XWalkExtensionClient() {
+  if (idle_timer_) {
+    ecore_timer_del(idle_timer_);
+  }
+  if (preload_thread_.joinable()) {
+    preload_thread_.join();
+  }
+  FlushExtensionUsage();
+  XWalkExtensionMetrics::GetInstance()->Dump();
+}
+
+void XWalkExtensionClient::Initialize(const std::string& app_id) {
+  if (getenv(kExtensionHostEnableKey) != NULL &&
+      ConnectExtensionHost(app_id)) {
+    return;
+  }
+
+  // The preloaded extensions may read these before the runtime pushes them.
+  manager_.SetRuntimeVariable(common::kAppDBRuntimeAppID, app_id);
+  manager_.SetRuntimeVariable(common::kAppDBRuntimeName, common::kRuntimeName);
+  manager_.LoadExtensions(true, true);
+  if (!idle_timer_) {
+    idle_timer_ = ecore_timer_add(kIdleCheckInterval, OnIdleTimer, this);
+  }
+}
+
+// static
+Eina_Bool XWalkExtensionClient::OnIdleTimer(void* data) {
+  XWalkExtensionClient* self = static_cast<XWalkExtensionClient*>(data);
+  self->FlushExtensionUsage();
+  self->manager_.UnloadIdleExtensions(kIdleUnloadTime);
+  return ECORE_CALLBACK_RENEW;
+}
+
+void XWalkExtensionClient::OnLowMemory() {
+  // The renderer may be killed soon.
+  DumpMetrics();
+  // The extension host has no extensions loaded in this process.
+  if (host_client_) {
+    return;
+  }
+  FlushExtensionUsage();
+  manager_.UnloadIdleExtensions(0, true);
+}
+
+void XWalkExtensionClient::DumpMetrics() {
+  if (!XWalkExtensionMetrics::enabled()) {
+    return;
+  }
+  std::string host_metrics;
+  if (host_client_) {
+    GVariant* reply = host_client_->Call(
+        kDBusInterfaceNameForExtension, kMethodGetMetrics, NULL,
+        G_VARIANT_TYPE("(s)"));
+    if (reply) {
+      const gchar* metrics;
+      g_variant_get(reply, "(&s)", &metrics);
+      host_metrics = metrics;
+      g_variant_unref(reply);
+    }
+  }
+  XWalkExtensionMetrics::GetInstance()->Dump(host_metrics);
+}
+
+void XWalkExtensionClient::SetRuntimeVariables(const std::string& variables) {
+  picojson::value value;
+  std::string err;
+  picojson::parse(value, variables.begin(), variables.end(), &err);
+  if (!err.empty() || !value.is<picojson::object>()) {
+    LOGGER(ERROR) << "Invalid runtime variables : " << err;
+    return;
+  }
+  picojson::object& object = value.get<picojson::object>();
+  for (auto it = object.begin(); it != object.end(); ++it) {
+    if (it->second.is<std::string>()) {
+      manager_.SetRuntimeVariable(it->first, it->second.get<std::string>());
+    }
+  }
+}
+
+bool XWalkExtensionClient::ConnectExtensionHost(const std::string& app_id) {
+  SCOPE_PROFILE();
+  std::string name = app_id + "." + kDBusNameForExtension;
+  std::string socket_path =
+      common::utils::GetUserRuntimeDir() + "/." + name;
+
+  // The runtime starts the renderer after the socket of the extension host
+  // is ready, so the host is not waited for here.
+  std::unique_ptr<common::DBusClient> client(new common::DBusClient());
+  if (!common::utils::Exists(socket_path) || !client->ConnectByName(name)) {
+    LOGGER(WARN) << "Extension host is not available, "
+                 << "the extensions are loaded in the renderer.";
+    return false;
+  }
+
+  GVariant* reply = client->Call(kDBusInterfaceNameForExtension,
+                                 kMethodGetExtensions, NULL,
+                                 G_VARIANT_TYPE("(a(sas))"));
+  if (!reply) {
+    LOGGER(ERROR) << "Failed to get extensions from the extension host.";
+    return false;
+  }
+
+  GVariantIter* it;
+  gchar* extension_name;
+  GVariantIter* entry_points_it;
+  g_variant_get(reply, "(a(sas))", &it);
+  while (g_variant_iter_loop(it, "(sas)", &extension_name,
+                             &entry_points_it)) {
+    XWalkExtension::StringVector& entry_points =
+        host_extensions_[extension_name];
+    gchar* entry_point;
+    while (g_variant_iter_loop(entry_points_it, "s", &entry_point)) {
+      entry_points.push_back(entry_point);
+    }
+  }
+  g_variant_iter_free(it);
+  g_variant_unref(reply);
+
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  using std::placeholders::_3;
+  client->SetSignalCallback(
+      kDBusInterfaceNameForExtension,
+      std::bind(&XWalkExtensionClient::HandleSignalFromHost, this,
+                _1, _2, _3));
+  host_client_ = std::move(client);
+
+  LOGGER(DEBUG) << host_extensions_.size()
+                << " extensions are served by the extension host.";
+  return true;
+}
+
+void XWalkExtensionClient::HandleSignalFromHost(const std::string& signal,
+                                                GVariant* parameters,
+                                                GUnixFDList* fd_list) {
+  if (signal == kSignalOnMessageToJS) {
+    const gchar* instance_id;
+    GVariant* payload;
+    g_variant_get(parameters, "(&s@v)", &instance_id, &payload);
+    InstanceHandler* handler = GetHostInstanceHandler(instance_id);
+    if (handler) {
+      common::DBusPayload::Unpack(payload, fd_list,
+          [handler](const void* data, size_t size) {
+        handler->HandleMessageFromNative(
+            std::string(static_cast<const char*>(data), size));
+      });
+    }
+    g_variant_unref(payload);
+  } else if (signal == kSignalOnBinaryMessageToJS) {
+    const gchar* instance_id;
+    GVariant* payload;
+    g_variant_get(parameters, "(&s@v)", &instance_id, &payload);
+    InstanceHandler* handler = GetHostInstanceHandler(instance_id);
+    if (handler) {
+      common::DBusPayload::Unpack(payload, fd_list,
+          [handler](const void* data, size_t size) {
+        handler->HandleBinaryMessageFromNative(data, size);
+      });
+    }
+    g_variant_unref(payload);
+  } else if (signal == kSignalOnAsyncReplyToJS) {
+    const gchar* instance_id;
+    gint32 request_id;
+    const gchar* reply;
+    g_variant_get(parameters, "(&si&s)", &instance_id, &request_id, &reply);
+    InstanceHandler* handler = GetHostInstanceHandler(instance_id);
+    if (handler) {
+      handler->HandleAsyncReplyFromNative(request_id, reply);
+    }
+  }
 }
 
-void XWalkExtensionClient::Initialize() {
-  manager_.LoadExtensions();
+void XWalkExtensionClient::PostPayloadToHost(const char* method,
+                                             const std::string& instance_id,
+                                             const void* data, size_t size) {
+  // Large payloads are passed in shared memory instead of the message.
+  GUnixFDList* fd_list =
+      common::DBusPayload::NewFDList(host_client_->connection());
+  GVariant* payload = common::DBusPayload::Pack(data, size, fd_list);
+  host_client_->Call(kDBusInterfaceNameForExtension, method,
+                     g_variant_new("(s@v)", instance_id.c_str(), payload),
+                     NULL, fd_list);
+  if (fd_list) {
+    g_object_unref(fd_list);
+  }
 }
 
-XWalkExtension* XWalkExtensionClient::GetExtension(
+XWalkExtensionClient::InstanceHandler*
+XWalkExtensionClient::GetHostInstanceHandler(const std::string& instance_id) {
+  // The instance may be destroyed while its messages are in flight.
+  auto it = host_instances_.find(instance_id);
+  if (it == host_instances_.end()) {
+    return NULL;
+  }
+  return it->second;
+}
+
+void XWalkExtensionClient::PreloadExtensions() {
+  SCOPE_PROFILE();
+  if (host_client_ || preload_thread_.joinable()) {
+    return;
+  }
+
+  common::AppDB* db = common::AppDB::GetInstance();
+  std::list<std::string> names;
+  db->GetKeys(kAppDBExtensionUsageSection, &names);
+
+  XWalkExtensionManager::ExtensionMap extensions = manager_.extensions();
+  std::vector<XWalkExtension*> preloads;
+  for (auto it = names.begin(); it != names.end(); ++it) {
+    auto found = extensions.find(*it);
+    if (found == extensions.end()) {
+      // The extension was removed from the platform.
+      db->Remove(kAppDBExtensionUsageSection, *it);
+      continue;
+    }
+    used_extensions_.insert(*it);
+    if (found->second->lazy_loading()) {
+      preloads.push_back(found->second);
+    }
+  }
+
+  if (preloads.empty()) {
+    return;
+  }
+
+  preload_thread_ = std::thread([preloads]() {
+    SCOPE_PROFILE();
+    for (auto it = preloads.begin(); it != preloads.end(); ++it) {
+      (*it)->Initialize();
+    }
+  });
+}
+
+void XWalkExtensionClient::RecordExtensionUsage(
+    const std::string& extension_name) {
+  if (used_extensions_.find(extension_name) != used_extensions_.end()) {
+    return;
+  }
+  used_extensions_.insert(extension_name);
+  // Written later by FlushExtensionUsage(), off the JavaScript call path.
+  pending_usages_.insert(extension_name);
+}
+
+void XWalkExtensionClient::FlushExtensionUsage() {
+  if (pending_usages_.empty()) {
+    return;
+  }
+  common::AppDB* db = common::AppDB::GetInstance();
+  for (auto it = pending_usages_.begin(); it != pending_usages_.end(); ++it) {
+    db->Set(kAppDBExtensionUsageSection, *it, "1");
+  }
+  pending_usages_.clear();
+}
+
+XWalkExtensionClient::EntryPointsMap XWalkExtensionClient::GetExtensions() {
+  if (host_client_) {
+    return host_extensions_;
+  }
+
+  EntryPointsMap entry_points;
+  XWalkExtensionManager::ExtensionMap extensions = manager_.extensions();
+  for (auto it = extensions.begin(); it != extensions.end(); ++it) {
+    entry_points[it->first] = it->second->entry_points();
+  }
+  return entry_points;
+}
+
+std::string XWalkExtensionClient::GetJavascriptCode(
     const std::string& extension_name) {
+  if (host_client_) {
+    // The code never changes, so it is fetched once for all the frames.
+    auto cached = host_javascript_codes_.find(extension_name);
+    if (cached != host_javascript_codes_.end()) {
+      return cached->second;
+    }
+    GVariant* reply = host_client_->Call(
+        kDBusInterfaceNameForExtension, kMethodGetJavascriptCode,
+        g_variant_new("(s)", extension_name.c_str()),
+        G_VARIANT_TYPE("(s)"));
+    if (!reply) {
+      LOGGER(ERROR) << "Failed to get the JavaScript code of '"
+                    << extension_name << "'";
+      return std::string();
+    }
+    const gchar* code;
+    g_variant_get(reply, "(&s)", &code);
+    std::string ret(code);
+    g_variant_unref(reply);
+    host_javascript_codes_[extension_name] = ret;
+    return ret;
+  }
+
   // find extension with given the extension name
-  ExtensionMap extensions = manager_.extensions();
+  XWalkExtensionManager::ExtensionMap extensions = manager_.extensions();
   auto it = extensions.find(extension_name);
   if (it == extensions.end()) {
     LOGGER(ERROR) << "No such extension '" << extension_name << "'";
-    return nullptr;
+    return std::string();
   }
 
-  return it->second;
-}
-
-XWalkExtensionClient::ExtensionMap XWalkExtensionClient::GetExtensions() {
-  return manager_.extensions();
+  return it->second->GetJavascriptCode();
 }
 
 std::string XWalkExtensionClient::CreateInstance(
     const std::string& extension_name, InstanceHandler* handler) {
   std::string instance_id = common::utils::GenerateUUID();
 
+  if (host_client_) {
+    if (host_extensions_.find(extension_name) == host_extensions_.end()) {
+      LOGGER(ERROR) << "No such extension '" << extension_name << "'";
+      return std::string();
+    }
+    // The calls on a connection are ordered, so the messages posted right
+    // after this reach the created instance.
+    host_client_->Call(kDBusInterfaceNameForExtension, kMethodCreateInstance,
+                       g_variant_new("(ss)", instance_id.c_str(),
+                                     extension_name.c_str()),
+                       NULL);
+    host_instances_[instance_id] = handler;
+    return instance_id;
+  }
+
   // find extension with given the extension name
-  ExtensionMap extensions = manager_.extensions();
+  XWalkExtensionManager::ExtensionMap extensions = manager_.extensions();
   auto it = extensions.find(extension_name);
   if (it == extensions.end()) {
     LOGGER(ERROR) << "No such extension '" << extension_name << "'";
@@ -65,6 +383,8 @@ std::string XWalkExtensionClient::CreateInstance(
     return std::string();
   }
 
+  RecordExtensionUsage(extension_name);
+
   // set callbacks
   using std::placeholders::_1;
   instance->SetPostMessageCallback([handler](const std::string& msg) {
@@ -72,12 +392,31 @@ std::string XWalkExtensionClient::CreateInstance(
       handler->HandleMessageFromNative(msg);
     }
   });
+  instance->SetPostBinaryMessageCallback(
+      [handler](const void* data, size_t size) {
+    if (handler) {
+      handler->HandleBinaryMessageFromNative(data, size);
+    }
+  });
+  instance->SetAsyncReplyCallback(
+      [handler](int32_t request_id, const std::string& reply) {
+    if (handler) {
+      handler->HandleAsyncReplyFromNative(request_id, reply);
+    }
+  });
 
   instances_[instance_id] = instance;
   return instance_id;
 }
 
 void XWalkExtensionClient::DestroyInstance(const std::string& instance_id) {
+  if (host_client_) {
+    host_instances_.erase(instance_id);
+    host_client_->Call(kDBusInterfaceNameForExtension, kMethodDestroyInstance,
+                       g_variant_new("(s)", instance_id.c_str()), NULL);
+    return;
+  }
+
   // find instance with the given instance id
   auto it = instances_.find(instance_id);
   if (it == instances_.end()) {
@@ -85,15 +424,20 @@ void XWalkExtensionClient::DestroyInstance(const std::string& instance_id) {
     return;
   }
 
-  // destroy the instance
+  // destroy the instance, or keep it for the next page
   XWalkExtensionInstance* instance = it->second;
-  delete instance;
+  instance->extension()->ReleaseInstance(instance);
 
   instances_.erase(it);
 }
 
 void XWalkExtensionClient::PostMessageToNative(
     const std::string& instance_id, const std::string& msg) {
+  if (host_client_) {
+    PostPayloadToHost(kMethodPostMessage, instance_id, msg.data(), msg.size());
+    return;
+  }
+
   // find instance with the given instance id
   auto it = instances_.find(instance_id);
   if (it == instances_.end()) {
@@ -106,8 +450,66 @@ void XWalkExtensionClient::PostMessageToNative(
   instance->HandleMessage(msg);
 }
 
+void XWalkExtensionClient::PostBinaryMessageToNative(
+    const std::string& instance_id, const void* data, size_t size) {
+  if (host_client_) {
+    PostPayloadToHost(kMethodPostBinaryMessage, instance_id, data, size);
+    return;
+  }
+
+  // find instance with the given instance id
+  auto it = instances_.find(instance_id);
+  if (it == instances_.end()) {
+    LOGGER(ERROR) << "No such instance '" << instance_id << "'";
+    return;
+  }
+
+  // Post a binary message
+  XWalkExtensionInstance* instance = it->second;
+  instance->HandleBinaryMessage(data, size);
+}
+
+void XWalkExtensionClient::SendAsyncMessageToNative(
+    const std::string& instance_id, int32_t request_id,
+    const std::string& msg) {
+  if (host_client_) {
+    host_client_->Call(kDBusInterfaceNameForExtension,
+                       kMethodSendAsyncMessage,
+                       g_variant_new("(sis)", instance_id.c_str(), request_id,
+                                     msg.c_str()),
+                       NULL);
+    return;
+  }
+
+  // find instance with the given instance id
+  auto it = instances_.find(instance_id);
+  if (it == instances_.end()) {
+    LOGGER(ERROR) << "No such instance '" << instance_id << "'";
+    return;
+  }
+
+  // Post a message, the reply message is delivered later
+  XWalkExtensionInstance* instance = it->second;
+  instance->HandleAsyncMessage(request_id, msg);
+}
+
 std::string XWalkExtensionClient::SendSyncMessageToNative(
     const std::string& instance_id, const std::string& msg) {
+  if (host_client_) {
+    GVariant* reply = host_client_->Call(
+        kDBusInterfaceNameForExtension, kMethodSendSyncMessage,
+        g_variant_new("(ss)", instance_id.c_str(), msg.c_str()),
+        G_VARIANT_TYPE("(s)"));
+    if (!reply) {
+      return std::string();
+    }
+    const gchar* reply_msg;
+    g_variant_get(reply, "(&s)", &reply_msg);
+    std::string ret(reply_msg);
+    g_variant_unref(reply);
+    return ret;
+  }
+
   // find instance with the given instance id
   auto it = instances_.find(instance_id);
   if (it == instances_.end()) {
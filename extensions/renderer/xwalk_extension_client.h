@@ -6,11 +6,18 @@
 #ifndef XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_CLIENT_H_
 #define XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_CLIENT_H_
 
+#include <Ecore.h>
+#include <gio/gio.h>
+#include <glib.h>
+
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "common/dbus_client.h"
 #include "extensions/common/xwalk_extension.h"
 #include "extensions/common/xwalk_extension_instance.h"
 #include "extensions/common/xwalk_extension_manager.h"
@@ -19,11 +26,15 @@ namespace extensions {
 
 class XWalkExtensionClient {
  public:
-  typedef std::map<std::string, XWalkExtension*> ExtensionMap;
+  typedef std::map<std::string, XWalkExtension::StringVector> EntryPointsMap;
   typedef std::map<std::string, XWalkExtensionInstance*> InstanceMap;
 
   struct InstanceHandler {
     virtual void HandleMessageFromNative(const std::string& msg) = 0;
+    virtual void HandleBinaryMessageFromNative(const void* data,
+                                               size_t size) = 0;
+    virtual void HandleAsyncReplyFromNative(int32_t request_id,
+                                            const std::string& reply) = 0;
    protected:
     ~InstanceHandler() {}
   };
@@ -31,10 +42,29 @@ class XWalkExtensionClient {
   XWalkExtensionClient();
   virtual ~XWalkExtensionClient();
 
-  void Initialize();
+  // Connects to the shared extension host of |app_id| if it is enabled and
+  // running, otherwise loads the extensions in this process.
+  void Initialize(const std::string& app_id);
+
+  // Initializes the extensions which were used by the application in the
+  // previous launches on a background thread, so the first call to them
+  // doesn't stall the JavaScript of the application.
+  void PreloadExtensions();
+
+  // Releases the pooled instances and unloads all the unloadable extensions
+  // which have no live instances. They are loaded again on the next use.
+  void OnLowMemory();
 
-  XWalkExtension* GetExtension(const std::string& extension_name);
-  ExtensionMap GetExtensions();
+  // Writes the extension metrics of this renderer and of the extension
+  // host, if the metrics are enabled.
+  void DumpMetrics();
+
+  // Sets the runtime variables pushed by the runtime, as a JSON object.
+  void SetRuntimeVariables(const std::string& variables);
+
+  // Returns the entry points of the extensions by their names.
+  EntryPointsMap GetExtensions();
+  std::string GetJavascriptCode(const std::string& extension_name);
 
   std::string CreateInstance(const std::string& extension_name,
                              InstanceHandler* handler);
@@ -44,10 +74,43 @@ class XWalkExtensionClient {
                            const std::string& msg);
   std::string SendSyncMessageToNative(const std::string& instance_id,
                                       const std::string& msg);
+  void PostBinaryMessageToNative(const std::string& instance_id,
+                                 const void* data, size_t size);
+  // The reply is passed to HandleAsyncReplyFromNative() of the instance
+  // handler, possibly before this function returns.
+  void SendAsyncMessageToNative(const std::string& instance_id,
+                                int32_t request_id, const std::string& msg);
 
  private:
+  void RecordExtensionUsage(const std::string& extension_name);
+  void FlushExtensionUsage();
+
+  static Eina_Bool OnIdleTimer(void* data);
+
+  bool ConnectExtensionHost(const std::string& app_id);
+  void HandleSignalFromHost(const std::string& signal, GVariant* parameters,
+                            GUnixFDList* fd_list);
+  void PostPayloadToHost(const char* method, const std::string& instance_id,
+                         const void* data, size_t size);
+  InstanceHandler* GetHostInstanceHandler(const std::string& instance_id);
+
   XWalkExtensionManager manager_;
   InstanceMap instances_;
+
+  std::set<std::string> used_extensions_;
+  // The used extensions which are not written to the AppDB yet.
+  std::set<std::string> pending_usages_;
+  std::thread preload_thread_;
+
+  // Periodically unloads the extensions which are not used for a while.
+  Ecore_Timer* idle_timer_;
+
+  // Set if the extensions run in the shared extension host. The instances
+  // live in the host then, and the messages are routed by the instance id.
+  std::unique_ptr<common::DBusClient> host_client_;
+  EntryPointsMap host_extensions_;
+  std::map<std::string, std::string> host_javascript_codes_;
+  std::map<std::string, InstanceHandler*> host_instances_;
 };
 
 }  // namespace extensions
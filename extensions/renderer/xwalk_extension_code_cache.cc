@@ -0,0 +1,184 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "extensions/renderer/xwalk_extension_code_cache.h"
+
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "common/file_utils.h"
+#include "common/logger.h"
+#include "common/profiler.h"
+
+namespace extensions {
+
+namespace {
+
+const char kCodeCacheDir[] = "xwalk-code-cache";
+const char kCodeCacheSuffix[] = ".cache";
+// Separates the parts of the keys. It can't be in the extension names, which
+// are JavaScript namespaces.
+const char kCodeCacheKeySeparator = '-';
+
+}  // namespace
+
+XWalkExtensionCodeCache::XWalkExtensionCodeCache()
+    : cache_dir_(common::utils::GetUserCacheDir(kCodeCacheDir)) {
+  if (cache_dir_.empty()) {
+    LOGGER(WARN) << "Code cache is not saved, no safe cache directory.";
+  }
+}
+
+XWalkExtensionCodeCache::~XWalkExtensionCodeCache() {
+}
+
+// static
+XWalkExtensionCodeCache* XWalkExtensionCodeCache::GetInstance() {
+  static XWalkExtensionCodeCache self;
+  return &self;
+}
+
+v8::Handle<v8::Script> XWalkExtensionCodeCache::Compile(
+    const std::string& name, const std::string& code) {
+  SCOPE_PROFILE();
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::EscapableHandleScope handle_scope(isolate);
+  v8::Handle<v8::String> v8_code(
+      v8::String::NewFromUtf8(isolate, code.c_str(), v8::String::kNormalString,
+                              static_cast<int>(code.size())));
+
+  std::string key = GetKey(name, code);
+  CacheMap& cache = caches_[isolate];
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    std::string data;
+    if (Load(key, &data)) {
+      it = cache.insert(std::make_pair(key, data)).first;
+    }
+  }
+
+  if (it != cache.end()) {
+    // The data is kept in |cache| while V8 reads it.
+    v8::ScriptCompiler::Source source(v8_code,
+        new v8::ScriptCompiler::CachedData(
+            reinterpret_cast<const uint8_t*>(it->second.data()),
+            static_cast<int>(it->second.size())));
+    v8::Local<v8::Script> script = v8::ScriptCompiler::Compile(
+        isolate, &source, v8::ScriptCompiler::kConsumeCodeCache);
+    if (!source.GetCachedData()->rejected) {
+      return handle_scope.Escape(script);
+    }
+    // The cache was produced by another build of V8 with the same version,
+    // or is broken. V8 compiled the source anyway.
+    LOGGER(WARN) << "Code cache of " << name << " is rejected.";
+    cache.erase(it);
+    Remove(key);
+    return handle_scope.Escape(script);
+  }
+
+  v8::ScriptCompiler::Source source(v8_code);
+  v8::Local<v8::Script> script = v8::ScriptCompiler::Compile(
+      isolate, &source, v8::ScriptCompiler::kProduceCodeCache);
+  const v8::ScriptCompiler::CachedData* cached_data = source.GetCachedData();
+  if (!script.IsEmpty() && cached_data && cached_data->length > 0) {
+    std::string data(reinterpret_cast<const char*>(cached_data->data),
+                     cached_data->length);
+    Save(key, data);
+    RemoveStale(name, key);
+    cache[key].swap(data);
+  }
+  return handle_scope.Escape(script);
+}
+
+// static
+std::string XWalkExtensionCodeCache::GetKey(const std::string& name,
+                                            const std::string& code) {
+  std::ostringstream key;
+  key << name << kCodeCacheKeySeparator
+      << std::hex << std::hash<std::string>()(code)
+      << kCodeCacheKeySeparator << v8::V8::GetVersion();
+  return key.str();
+}
+
+std::string XWalkExtensionCodeCache::GetCachePath(
+    const std::string& key) const {
+  return cache_dir_ + "/" + key + kCodeCacheSuffix;
+}
+
+bool XWalkExtensionCodeCache::Load(const std::string& key,
+                                   std::string* data) const {
+  if (cache_dir_.empty())
+    return false;
+  std::ifstream in(GetCachePath(key).c_str(),
+                   std::ios::in | std::ios::binary);
+  if (!in)
+    return false;
+  std::ostringstream buffer;
+  buffer << in.rdbuf();
+  *data = buffer.str();
+  return !data->empty();
+}
+
+void XWalkExtensionCodeCache::Save(const std::string& key,
+                                   const std::string& data) const {
+  if (cache_dir_.empty())
+    return;
+
+  // Renderers of other applications may read the cache at the same time, so
+  // the new cache is written aside and renamed over the old one.
+  std::string path = GetCachePath(key);
+  std::string temp_path = path + ".XXXXXX";
+  int fd = mkstemp(&temp_path[0]);
+  if (fd < 0) {
+    LOGGER(WARN) << "Fail to write the code cache " << path;
+    return;
+  }
+  bool written = write(fd, data.data(), data.size()) ==
+                 static_cast<ssize_t>(data.size());
+  if (close(fd) != 0 || !written) {
+    LOGGER(WARN) << "Fail to write the code cache " << temp_path;
+    unlink(temp_path.c_str());
+    return;
+  }
+  if (rename(temp_path.c_str(), path.c_str()) != 0) {
+    LOGGER(WARN) << "Fail to write the code cache " << path;
+    unlink(temp_path.c_str());
+  }
+}
+
+void XWalkExtensionCodeCache::Remove(const std::string& key) const {
+  if (cache_dir_.empty())
+    return;
+  unlink(GetCachePath(key).c_str());
+}
+
+void XWalkExtensionCodeCache::RemoveStale(const std::string& name,
+                                          const std::string& key) const {
+  if (cache_dir_.empty())
+    return;
+
+  // The caches of |name| for the other sources or V8 versions are never
+  // used again.
+  std::string pattern = cache_dir_ + "/" + name + kCodeCacheKeySeparator +
+                        "*" + kCodeCacheSuffix;
+  std::string path = GetCachePath(key);
+  glob_t glob_result;
+  if (glob(pattern.c_str(), GLOB_NOSORT, NULL, &glob_result) == 0) {
+    for (size_t i = 0; i < glob_result.gl_pathc; ++i) {
+      if (path != glob_result.gl_pathv[i])
+        unlink(glob_result.gl_pathv[i]);
+    }
+    globfree(&glob_result);
+  }
+}
+
+}  // namespace extensions
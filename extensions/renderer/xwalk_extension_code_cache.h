@@ -0,0 +1,50 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_CODE_CACHE_H_
+#define XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_CODE_CACHE_H_
+
+#include <v8/v8.h>
+
+#include <map>
+#include <string>
+
+namespace extensions {
+
+// Keeps the V8 code cache of the JavaScript APIs of the extensions, so the
+// APIs are not parsed and compiled again in every script context.
+// The cache data is kept in memory per isolate, and is saved in the private
+// cache directory of the user for the next renderers. It is keyed by the
+// extension name, the hash of the source and the V8 version, and the saved
+// caches of the other keys of an extension are removed.
+class XWalkExtensionCodeCache {
+ public:
+  static XWalkExtensionCodeCache* GetInstance();
+
+  // Compiles |code| in the current isolate using the cache of |name|, or
+  // produces the cache. Returns an empty handle if |code| doesn't compile.
+  v8::Handle<v8::Script> Compile(const std::string& name,
+                                 const std::string& code);
+
+ private:
+  typedef std::map<std::string, std::string> CacheMap;
+
+  XWalkExtensionCodeCache();
+  virtual ~XWalkExtensionCodeCache();
+
+  static std::string GetKey(const std::string& name, const std::string& code);
+  std::string GetCachePath(const std::string& key) const;
+
+  bool Load(const std::string& key, std::string* data) const;
+  void Save(const std::string& key, const std::string& data) const;
+  void Remove(const std::string& key) const;
+  void RemoveStale(const std::string& name, const std::string& key) const;
+
+  std::string cache_dir_;
+  std::map<v8::Isolate*, CacheMap> caches_;
+};
+
+}  // namespace extensions
+
+#endif  // XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_CODE_CACHE_H_
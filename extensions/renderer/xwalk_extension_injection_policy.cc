@@ -0,0 +1,106 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "extensions/renderer/xwalk_extension_injection_policy.h"
+
+#include <stdlib.h>
+
+#include <sstream>
+#include <string>
+
+#include "common/application_data.h"
+#include "common/logger.h"
+#include "common/string_utils.h"
+
+namespace extensions {
+
+namespace {
+
+const char kInjectionPolicyKey[] = "WRT_EXTENSION_INJECTION";
+const char kInjectionPolicyMetaDataKey[] =
+    "http://tizen.org/metadata/extension-injection";
+
+const char kSubframePolicy[] = "subframe";
+const char kBlankPolicy[] = "blank";
+const char kBlankURLPrefix[] = "about:";
+
+}  // namespace
+
+XWalkExtensionInjectionPolicy::XWalkExtensionInjectionPolicy()
+    : defer_subframes_(false),
+      defer_blank_documents_(false) {
+}
+
+XWalkExtensionInjectionPolicy::~XWalkExtensionInjectionPolicy() {
+}
+
+// static
+XWalkExtensionInjectionPolicy* XWalkExtensionInjectionPolicy::GetInstance() {
+  static XWalkExtensionInjectionPolicy self;
+  return &self;
+}
+
+void XWalkExtensionInjectionPolicy::Initialize(
+    const common::ApplicationData* app_data) {
+  defer_subframes_ = false;
+  defer_blank_documents_ = false;
+  deferred_url_prefixes_.clear();
+
+  const char* policy = getenv(kInjectionPolicyKey);
+  if (policy != NULL) {
+    ParsePolicy(policy);
+    return;
+  }
+
+  auto meta_data = app_data->meta_data_info();
+  if (meta_data != NULL && meta_data->HasKey(kInjectionPolicyMetaDataKey))
+    ParsePolicy(meta_data->GetValue(kInjectionPolicyMetaDataKey));
+}
+
+void XWalkExtensionInjectionPolicy::ParsePolicy(const std::string& policy) {
+  std::istringstream stream(policy);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    size_t begin = item.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+      continue;
+    item = item.substr(begin, item.find_last_not_of(" \t") - begin + 1);
+
+    if (item == kSubframePolicy)
+      defer_subframes_ = true;
+    else if (item == kBlankPolicy)
+      defer_blank_documents_ = true;
+    else
+      deferred_url_prefixes_.push_back(item);
+  }
+  LOGGER(DEBUG) << "Extension injection policy : " << policy;
+}
+
+bool XWalkExtensionInjectionPolicy::ShouldDefer(
+    v8::Handle<v8::Context> context, const std::string& url) const {
+  if (defer_blank_documents_ &&
+      (url.empty() || common::utils::StartsWith(url, kBlankURLPrefix)))
+    return true;
+
+  auto it = deferred_url_prefixes_.begin();
+  for (; it != deferred_url_prefixes_.end(); ++it) {
+    if (common::utils::StartsWith(url, *it))
+      return true;
+  }
+
+  if (defer_subframes_) {
+    v8::Isolate* isolate = context->GetIsolate();
+    v8::HandleScope handle_scope(isolate);
+    v8::Context::Scope context_scope(context);
+    v8::Handle<v8::Object> global = context->Global();
+    v8::Handle<v8::Value> top =
+        global->Get(v8::String::NewFromUtf8(isolate, "top"));
+    if (!top->StrictEquals(global))
+      return true;
+  }
+
+  return false;
+}
+
+}  // namespace extensions
@@ -0,0 +1,51 @@
+// Copyright (c) 2015 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_INJECTION_POLICY_H_
+#define XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_INJECTION_POLICY_H_
+
+#include <v8/v8.h>
+
+#include <string>
+#include <vector>
+
+namespace common {
+class ApplicationData;
+}  // namespace common
+
+namespace extensions {
+
+// Decides which script contexts get the extensions as soon as they are
+// created. The other contexts get them when they first touch one of the
+// namespaces of the extensions, e.g. 'tizen' or 'xwalk'.
+//
+// The policy is a comma separated list of the contexts to defer, given by
+// the "http://tizen.org/metadata/extension-injection" metadata of the
+// manifest or by the WRT_EXTENSION_INJECTION environment variable:
+//   subframe   - the contexts of the frames other than the main frame.
+//   blank      - the contexts of blank documents, like about:blank.
+//   <prefix>   - the contexts of the documents whose URL begins with it.
+class XWalkExtensionInjectionPolicy {
+ public:
+  static XWalkExtensionInjectionPolicy* GetInstance();
+
+  void Initialize(const common::ApplicationData* app_data);
+
+  bool ShouldDefer(v8::Handle<v8::Context> context,
+                   const std::string& url) const;
+
+ private:
+  XWalkExtensionInjectionPolicy();
+  virtual ~XWalkExtensionInjectionPolicy();
+
+  void ParsePolicy(const std::string& policy);
+
+  bool defer_subframes_;
+  bool defer_blank_documents_;
+  std::vector<std::string> deferred_url_prefixes_;
+};
+
+}  // namespace extensions
+
+#endif  // XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_INJECTION_POLICY_H_
@@ -9,12 +9,15 @@
 #include <v8/v8.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 
+#include <map>
 #include <vector>
 
 #include "common/logger.h"
 #include "extensions/renderer/runtime_ipc_client.h"
 #include "extensions/renderer/xwalk_extension_client.h"
+#include "extensions/renderer/xwalk_extension_code_cache.h"
 #include "extensions/renderer/xwalk_module_system.h"
 
 // The arraysize(arr) macro returns the # of elements in an array arr.
@@ -40,73 +43,54 @@ namespace extensions {
 
 namespace {
 
-// This is the key used in the data object passed to our callbacks to store a
-// pointer back to kXWalkExtensionModule.
-const char* kXWalkExtensionModule = "kXWalkExtensionModule";
+// The 'extension' objects keep a pointer back to their XWalkExtensionModule
+// in this internal field.
+const int kExtensionModuleField = 0;
 
 }  // namespace
 
 XWalkExtensionModule::XWalkExtensionModule(XWalkExtensionClient* client,
                                            XWalkModuleSystem* module_system,
                                            const std::string& extension_name) :
+    batch_messages_(false),
+    flush_job_(NULL),
+    next_request_id_(1),
+    reply_job_(NULL),
     extension_name_(extension_name),
     client_(client),
     module_system_(module_system) {
-  v8::Isolate* isolate = v8::Isolate::GetCurrent();
-  v8::HandleScope handle_scope(isolate);
-  v8::Handle<v8::Object> function_data = v8::Object::New(isolate);
-  function_data->Set(v8::String::NewFromUtf8(isolate, kXWalkExtensionModule),
-                     v8::External::New(isolate, this));
-
-  v8::Handle<v8::ObjectTemplate> object_template =
-      v8::ObjectTemplate::New(isolate);
-  // TODO(cmarcelo): Use Template::Set() function that takes isolate, once we
-  // update the Chromium (and V8) version.
-  object_template->Set(
-      v8::String::NewFromUtf8(isolate, "postMessage"),
-      v8::FunctionTemplate::New(isolate, PostMessageCallback, function_data));
-  object_template->Set(
-      v8::String::NewFromUtf8(isolate, "sendSyncMessage"),
-      v8::FunctionTemplate::New(
-          isolate, SendSyncMessageCallback, function_data));
-  object_template->Set(
-      v8::String::NewFromUtf8(isolate, "setMessageListener"),
-      v8::FunctionTemplate::New(
-          isolate, SetMessageListenerCallback, function_data));
-  object_template->Set(
-      v8::String::NewFromUtf8(isolate, "sendRuntimeMessage"),
-      v8::FunctionTemplate::New(
-          isolate, SendRuntimeMessageCallback, function_data));
-  object_template->Set(
-      v8::String::NewFromUtf8(isolate, "sendRuntimeSyncMessage"),
-      v8::FunctionTemplate::New(
-          isolate, SendRuntimeSyncMessageCallback, function_data));
-  object_template->Set(
-      v8::String::NewFromUtf8(isolate, "sendRuntimeAsyncMessage"),
-      v8::FunctionTemplate::New(
-          isolate, SendRuntimeAsyncMessageCallback, function_data));
-
-  function_data_.Reset(isolate, function_data);
-  object_template_.Reset(isolate, object_template);
 }
 
 XWalkExtensionModule::~XWalkExtensionModule() {
   v8::Isolate* isolate = v8::Isolate::GetCurrent();
   v8::HandleScope handle_scope(isolate);
 
-  // Deleting the data will disable the functions, they'll return early. We do
-  // this because it might be the case that the JS objects we created outlive
-  // this object (getting references from inside an iframe and then destroying
-  // the iframe), even if we destroy the references we have.
-  v8::Handle<v8::Object> function_data =
-      v8::Local<v8::Object>::New(isolate, function_data_);
-  function_data->Delete(v8::String::NewFromUtf8(isolate,
-                                                kXWalkExtensionModule));
-
-  object_template_.Reset();
-  function_data_.Reset();
+  // Clearing the pointer will disable the functions, they'll return early. We
+  // do this because it might be the case that the JS objects we created
+  // outlive this object (getting references from inside an iframe and then
+  // destroying the iframe), even if we destroy the references we have.
+  if (!extension_object_.IsEmpty()) {
+    v8::Handle<v8::Object> extension_object =
+        v8::Local<v8::Object>::New(isolate, extension_object_);
+    extension_object->SetAlignedPointerInInternalField(kExtensionModuleField,
+                                                       NULL);
+  }
+
+  extension_object_.Reset();
   message_listener_.Reset();
 
+  if (flush_job_)
+    ecore_job_del(flush_job_);
+  if (reply_job_)
+    ecore_job_del(reply_job_);
+
+  for (auto it = pending_replies_.begin(); it != pending_replies_.end();
+       ++it) {
+    it->second->Reset();
+    delete it->second;
+  }
+  pending_replies_.clear();
+
   if (!instance_id_.empty())
     client_->DestroyInstance(instance_id_);
 }
@@ -198,23 +182,56 @@ std::string StringPrintf(const char* format, ...) {
   return result;
 }
 
+// The wrapper of the API code. tools/generate_api.py wraps the APIs of the
+// internal extensions at build time in the same way. The functions of
+// 'extension' are bound to it, so the API code can pass them around.
+const char kAPICodeHead[] =
+    "; (function(extension, requireNative) { "
+    "extension.internal = {};"
+    "extension.internal.sendSyncMessage ="
+    " extension.sendSyncMessage.bind(extension);"
+    "delete extension.sendSyncMessage;"
+    "extension.postMessage ="
+    " extension.postMessage.bind(extension);"
+    "extension.sendAsyncMessage ="
+    " extension.sendAsyncMessage.bind(extension);"
+    "extension.setMessageListener ="
+    " extension.setMessageListener.bind(extension);"
+    "extension.sendRuntimeMessage ="
+    " extension.sendRuntimeMessage.bind(extension);"
+    "extension.sendRuntimeSyncMessage ="
+    " extension.sendRuntimeSyncMessage.bind(extension);"
+    "extension.sendRuntimeAsyncMessage ="
+    " extension.sendRuntimeAsyncMessage.bind(extension);"
+    "var Object = requireNative('objecttools');"
+    "var exports = {}; (function() {'use strict'; ";
+const char kAPICodeTail[] = "\n})();";
+const char kAPICodeEnd[] = " = exports; });";
+
+std::string APICodePrefix(const std::string& extension_name) {
+  return "var " + CodeToEnsureNamespace(extension_name) + kAPICodeHead;
+}
+
 // Wrap API code into a callable form that takes extension object as parameter.
+// The code is returned as is if it was wrapped at build time.
 std::string WrapAPICode(const std::string& extension_code,
                         const std::string& extension_name) {
   // We take care here to make sure that line numbering for api_code after
   // wrapping doesn't change, so that syntax errors point to the correct line.
+  std::string prefix = APICodePrefix(extension_name);
+  if (extension_code.compare(0, prefix.size(), prefix) == 0)
+    return extension_code;
 
-  return StringPrintf(
-      "var %s; (function(extension, requireNative) { "
-      "extension.internal = {};"
-      "extension.internal.sendSyncMessage = extension.sendSyncMessage;"
-      "delete extension.sendSyncMessage;"
-      "var Object = requireNative('objecttools');"
-      "var exports = {}; (function() {'use strict'; %s\n})();"
-      "%s = exports; });",
-      CodeToEnsureNamespace(extension_name).c_str(),
-      extension_code.c_str(),
-      extension_name.c_str());
+  std::string result;
+  result.reserve(prefix.size() + extension_code.size() +
+                 sizeof(kAPICodeTail) + extension_name.size() +
+                 sizeof(kAPICodeEnd));
+  result.append(prefix);
+  result.append(extension_code);
+  result.append(kAPICodeTail);
+  result.append(extension_name);
+  result.append(kAPICodeEnd);
+  return result;
 }
 
 std::string ExceptionToString(const v8::TryCatch& try_catch) {
@@ -236,18 +253,18 @@ std::string ExceptionToString(const v8::TryCatch& try_catch) {
   return str;
 }
 
-v8::Handle<v8::Value> RunString(const std::string& code,
+v8::Handle<v8::Value> RunString(const std::string& name,
+                                const std::string& code,
                                 std::string* exception) {
   v8::Isolate* isolate = v8::Isolate::GetCurrent();
   v8::EscapableHandleScope handle_scope(isolate);
-  v8::Handle<v8::String> v8_code(
-      v8::String::NewFromUtf8(isolate, code.c_str()));
 
   v8::TryCatch try_catch;
   try_catch.SetVerbose(true);
 
-  v8::Handle<v8::Script> script(v8::Script::Compile(v8_code));
-  if (try_catch.HasCaught()) {
+  v8::Handle<v8::Script> script(
+      XWalkExtensionCodeCache::GetInstance()->Compile(name, code));
+  if (try_catch.HasCaught() || script.IsEmpty()) {
     *exception = ExceptionToString(try_catch);
     return handle_scope.Escape(
         v8::Local<v8::Primitive>(v8::Undefined(isolate)));
@@ -275,16 +292,13 @@ void XWalkExtensionModule::LoadExtensionCode(
 
 
 
-  XWalkExtension* ext = client_->GetExtension(extension_name_);
-  if (ext == nullptr) {
-    LOGGER(ERROR) << "Failed to get an extension " << extension_name_;
-    return;
-  }
   std::string wrapped_api_code =
-      WrapAPICode(ext->GetJavascriptCode(), extension_name_);
+      WrapAPICode(client_->GetJavascriptCode(extension_name_),
+                  extension_name_);
 
   std::string exception;
-  v8::Handle<v8::Value> result = RunString(wrapped_api_code, &exception);
+  v8::Handle<v8::Value> result =
+      RunString(extension_name_, wrapped_api_code, &exception);
 
   if (!result->IsFunction()) {
     LOGGER(ERROR) << "Couldn't load JS API code for "
@@ -293,13 +307,16 @@ void XWalkExtensionModule::LoadExtensionCode(
   }
   v8::Handle<v8::Function> callable_api_code =
       v8::Handle<v8::Function>::Cast(result);
-  v8::Handle<v8::ObjectTemplate> object_template =
-      v8::Local<v8::ObjectTemplate>::New(context->GetIsolate(),
-                                          object_template_);
+  v8::Handle<v8::Object> extension_object =
+      GetExtensionTemplate(context->GetIsolate())->InstanceTemplate()->
+          NewInstance();
+  extension_object->SetAlignedPointerInInternalField(kExtensionModuleField,
+                                                     this);
+  extension_object_.Reset(context->GetIsolate(), extension_object);
 
   const int argc = 2;
   v8::Handle<v8::Value> argv[argc] = {
-    object_template->NewInstance(),
+    extension_object,
     require_native
   };
 
@@ -316,13 +333,137 @@ void XWalkExtensionModule::HandleMessageFromNative(const std::string& msg) {
   if (message_listener_.IsEmpty())
     return;
 
+  if (batch_messages_) {
+    pending_messages_.push_back(msg);
+    if (!flush_job_)
+      flush_job_ = ecore_job_add(FlushMessagesJob, this);
+    return;
+  }
+
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope handle_scope(isolate);
+  v8::Handle<v8::Context> context = module_system_->GetV8Context();
+  v8::Context::Scope context_scope(context);
+
+  CallMessageListener(v8::String::NewFromUtf8(isolate, msg.c_str(),
+                                              v8::String::kNormalString,
+                                              static_cast<int>(msg.size())));
+}
+
+void XWalkExtensionModule::HandleBinaryMessageFromNative(const void* data,
+                                                         size_t size) {
+  if (message_listener_.IsEmpty())
+    return;
+
+  // Binary messages are not batched, but keep their order with the batched
+  // string messages.
+  FlushMessages();
+
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope handle_scope(isolate);
+  v8::Handle<v8::Context> context = module_system_->GetV8Context();
+  v8::Context::Scope context_scope(context);
+
+  v8::Handle<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(isolate, size);
+  memcpy(buffer->GetContents().Data(), data, size);
+  CallMessageListener(buffer);
+}
+
+void XWalkExtensionModule::HandleAsyncReplyFromNative(
+    int32_t request_id, const std::string& reply) {
+  // Running the reactions under the JavaScript on the stack would break the
+  // order of the microtasks, so such replies wait for the main loop. The
+  // later ones wait as well, to keep their order.
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  if (isolate->InContext() || !deferred_replies_.empty()) {
+    deferred_replies_.push_back(std::make_pair(request_id, reply));
+    if (!reply_job_)
+      reply_job_ = ecore_job_add(ResolveDeferredRepliesJob, this);
+    return;
+  }
+
+  ResolveAsyncReply(request_id, reply);
+  // Replies from the main loop are not followed by a return to JavaScript,
+  // so the reactions of the promise are run here.
+  isolate->RunMicrotasks();
+}
+
+// static
+void XWalkExtensionModule::ResolveDeferredRepliesJob(void* data) {
+  XWalkExtensionModule* module = static_cast<XWalkExtensionModule*>(data);
+  module->reply_job_ = NULL;
+  std::vector<std::pair<int32_t, std::string>> replies;
+  replies.swap(module->deferred_replies_);
+  for (auto it = replies.begin(); it != replies.end(); ++it) {
+    module->ResolveAsyncReply(it->first, it->second);
+  }
+  // The reactions may destroy the module, so it isn't touched afterwards.
+  v8::Isolate::GetCurrent()->RunMicrotasks();
+}
+
+void XWalkExtensionModule::ResolveAsyncReply(
+    int32_t request_id, const std::string& reply) {
+  auto it = pending_replies_.find(request_id);
+  if (it == pending_replies_.end()) {
+    LOGGER(WARN) << "No request " << request_id << " for the reply of "
+                 << extension_name_;
+    return;
+  }
+  std::unique_ptr<v8::Persistent<v8::Promise::Resolver>> persistent(
+      it->second);
+  pending_replies_.erase(it);
+
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope handle_scope(isolate);
+  v8::Handle<v8::Context> context = module_system_->GetV8Context();
+  v8::Context::Scope context_scope(context);
+
+  v8::Handle<v8::Promise::Resolver> resolver =
+      v8::Local<v8::Promise::Resolver>::New(isolate, *persistent);
+  persistent->Reset();
+  resolver->Resolve(v8::String::NewFromUtf8(isolate, reply.c_str(),
+                                            v8::String::kNormalString,
+                                            static_cast<int>(reply.size())));
+}
+
+// static
+void XWalkExtensionModule::FlushMessagesJob(void* data) {
+  XWalkExtensionModule* module = static_cast<XWalkExtensionModule*>(data);
+  module->flush_job_ = NULL;
+  module->FlushMessages();
+}
+
+void XWalkExtensionModule::FlushMessages() {
+  if (flush_job_) {
+    ecore_job_del(flush_job_);
+    flush_job_ = NULL;
+  }
+  if (pending_messages_.empty())
+    return;
+  std::vector<std::string> messages;
+  messages.swap(pending_messages_);
+  if (message_listener_.IsEmpty())
+    return;
+
   v8::Isolate* isolate = v8::Isolate::GetCurrent();
   v8::HandleScope handle_scope(isolate);
   v8::Handle<v8::Context> context = module_system_->GetV8Context();
   v8::Context::Scope context_scope(context);
 
-  v8::Handle<v8::Value> args[] = {
-      v8::String::NewFromUtf8(isolate, msg.c_str()) };
+  v8::Handle<v8::Array> array = v8::Array::New(isolate, messages.size());
+  for (size_t i = 0; i < messages.size(); ++i) {
+    array->Set(i, v8::String::NewFromUtf8(
+        isolate, messages[i].c_str(), v8::String::kNormalString,
+        static_cast<int>(messages[i].size())));
+  }
+  CallMessageListener(array);
+}
+
+void XWalkExtensionModule::CallMessageListener(
+    v8::Handle<v8::Value> message) {
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::Handle<v8::Context> context = module_system_->GetV8Context();
+  v8::Handle<v8::Value> args[] = { message };
 
   v8::Handle<v8::Function> message_listener =
       v8::Local<v8::Function>::New(isolate, message_listener_);
@@ -344,11 +485,32 @@ void XWalkExtensionModule::PostMessageCallback(
     return;
   }
 
+  // ArrayBuffers and typed arrays are passed to the extension in place.
+  if (info[0]->IsArrayBuffer() || info[0]->IsArrayBufferView()) {
+    const char* data;
+    size_t size;
+    if (info[0]->IsArrayBuffer()) {
+      v8::ArrayBuffer::Contents contents =
+          info[0].As<v8::ArrayBuffer>()->GetContents();
+      data = static_cast<const char*>(contents.Data());
+      size = contents.ByteLength();
+    } else {
+      v8::Handle<v8::ArrayBufferView> view = info[0].As<v8::ArrayBufferView>();
+      v8::ArrayBuffer::Contents contents = view->Buffer()->GetContents();
+      data = static_cast<const char*>(contents.Data()) + view->ByteOffset();
+      size = view->ByteLength();
+    }
+    module->client_->PostBinaryMessageToNative(module->instance_id_,
+                                               data, size);
+    result.Set(true);
+    return;
+  }
+
   v8::String::Utf8Value value(info[0]->ToString());
 
   // CHECK(module->instance_id_);
   module->client_->PostMessageToNative(module->instance_id_,
-                                       std::string(*value));
+                                       std::string(*value, value.length()));
   result.Set(true);
 }
 
@@ -377,11 +539,43 @@ void XWalkExtensionModule::SendSyncMessageCallback(
 }
 
 // static
-void XWalkExtensionModule::SetMessageListenerCallback(
+void XWalkExtensionModule::SendAsyncMessageCallback(
     const v8::FunctionCallbackInfo<v8::Value>& info) {
+  v8::Isolate* isolate = info.GetIsolate();
+  v8::HandleScope handle_scope(isolate);
+
   v8::ReturnValue<v8::Value> result(info.GetReturnValue());
   XWalkExtensionModule* module = GetExtensionModule(info);
   if (!module || info.Length() != 1) {
+    result.SetUndefined();
+    return;
+  }
+
+  v8::Handle<v8::Promise::Resolver> resolver =
+      v8::Promise::Resolver::New(isolate);
+  result.Set(resolver->GetPromise());
+
+  if (module->instance_id_.empty()) {
+    resolver->Reject(v8::Exception::Error(v8::String::NewFromUtf8(
+        isolate, "The extension instance is not available.")));
+    return;
+  }
+
+  int32_t request_id = module->next_request_id_++;
+  module->pending_replies_[request_id] =
+      new v8::Persistent<v8::Promise::Resolver>(isolate, resolver);
+
+  v8::String::Utf8Value value(info[0]->ToString());
+  module->client_->SendAsyncMessageToNative(
+      module->instance_id_, request_id, std::string(*value, value.length()));
+}
+
+// static
+void XWalkExtensionModule::SetMessageListenerCallback(
+    const v8::FunctionCallbackInfo<v8::Value>& info) {
+  v8::ReturnValue<v8::Value> result(info.GetReturnValue());
+  XWalkExtensionModule* module = GetExtensionModule(info);
+  if (!module || info.Length() < 1 || info.Length() > 2) {
     result.Set(false);
     return;
   }
@@ -393,6 +587,18 @@ void XWalkExtensionModule::SetMessageListenerCallback(
   }
 
   v8::Isolate* isolate = info.GetIsolate();
+
+  // The messages queued for the previous listener go to it.
+  module->FlushMessages();
+
+  bool batch = false;
+  if (info.Length() > 1 && info[1]->IsObject()) {
+    v8::Handle<v8::Value> batch_value = info[1].As<v8::Object>()->Get(
+        v8::String::NewFromUtf8(isolate, "batch"));
+    batch = batch_value->BooleanValue();
+  }
+  module->batch_messages_ = batch;
+
   if (info[0]->IsUndefined())
     module->message_listener_.Reset();
   else
@@ -505,21 +711,70 @@ void XWalkExtensionModule::SendRuntimeAsyncMessageCallback(
   result.Set(true);
 }
 
+// static
+v8::Handle<v8::FunctionTemplate> XWalkExtensionModule::GetExtensionTemplate(
+    v8::Isolate* isolate) {
+  static std::map<v8::Isolate*, v8::Eternal<v8::FunctionTemplate>> templates;
+  v8::EscapableHandleScope handle_scope(isolate);
+  v8::Eternal<v8::FunctionTemplate>& eternal = templates[isolate];
+  if (!eternal.IsEmpty())
+    return handle_scope.Escape(eternal.Get(isolate));
+
+  v8::Handle<v8::FunctionTemplate> extension_template =
+      v8::FunctionTemplate::New(isolate);
+  v8::Handle<v8::ObjectTemplate> object_template =
+      extension_template->InstanceTemplate();
+  object_template->SetInternalFieldCount(1);
+  // TODO(cmarcelo): Use Template::Set() function that takes isolate, once we
+  // update the Chromium (and V8) version.
+  object_template->Set(
+      v8::String::NewFromUtf8(isolate, "postMessage"),
+      v8::FunctionTemplate::New(isolate, PostMessageCallback));
+  object_template->Set(
+      v8::String::NewFromUtf8(isolate, "sendSyncMessage"),
+      v8::FunctionTemplate::New(isolate, SendSyncMessageCallback));
+  object_template->Set(
+      v8::String::NewFromUtf8(isolate, "sendAsyncMessage"),
+      v8::FunctionTemplate::New(isolate, SendAsyncMessageCallback));
+  object_template->Set(
+      v8::String::NewFromUtf8(isolate, "setMessageListener"),
+      v8::FunctionTemplate::New(isolate, SetMessageListenerCallback));
+  object_template->Set(
+      v8::String::NewFromUtf8(isolate, "sendRuntimeMessage"),
+      v8::FunctionTemplate::New(isolate, SendRuntimeMessageCallback));
+  object_template->Set(
+      v8::String::NewFromUtf8(isolate, "sendRuntimeSyncMessage"),
+      v8::FunctionTemplate::New(isolate, SendRuntimeSyncMessageCallback));
+  object_template->Set(
+      v8::String::NewFromUtf8(isolate, "sendRuntimeAsyncMessage"),
+      v8::FunctionTemplate::New(isolate, SendRuntimeAsyncMessageCallback));
+
+  eternal.Set(isolate, extension_template);
+  return handle_scope.Escape(extension_template);
+}
+
 // static
 XWalkExtensionModule* XWalkExtensionModule::GetExtensionModule(
     const v8::FunctionCallbackInfo<v8::Value>& info) {
   v8::Isolate* isolate = info.GetIsolate();
   v8::HandleScope handle_scope(isolate);
 
-  v8::Local<v8::Object> data = info.Data().As<v8::Object>();
-  v8::Local<v8::Value> module =
-      data->Get(v8::String::NewFromUtf8(isolate, kXWalkExtensionModule));
-  if (module.IsEmpty() || module->IsUndefined()) {
+  // The functions are shared by all the 'extension' objects of a context, so
+  // the module is found from the object they are called on.
+  v8::Local<v8::Object> holder = info.This();
+  if (!GetExtensionTemplate(isolate)->HasInstance(holder)) {
+    isolate->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(
+        isolate, "Illegal invocation, the extension function must be called "
+                 "on the extension object.")));
+    return NULL;
+  }
+  void* module = holder->GetAlignedPointerFromInternalField(
+      kExtensionModuleField);
+  if (!module) {
     LOGGER(ERROR) << "Trying to use extension from already destroyed context!";
     return NULL;
   }
-  // CHECK(module->IsExternal());
-  return static_cast<XWalkExtensionModule*>(module.As<v8::External>()->Value());
+  return static_cast<XWalkExtensionModule*>(module);
 }
 
 }  // namespace extensions
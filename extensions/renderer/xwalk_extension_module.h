@@ -7,10 +7,14 @@
 #ifndef XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_MODULE_H_
 #define XWALK_EXTENSIONS_RENDERER_XWALK_EXTENSION_MODULE_H_
 
+#include <Ecore.h>
 #include <v8/v8.h>
 
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "extensions/renderer/xwalk_extension_client.h"
 
@@ -41,12 +45,28 @@ class XWalkExtensionModule : public XWalkExtensionClient::InstanceHandler {
  private:
   // ExtensionClient::InstanceHandler implementation.
   virtual void HandleMessageFromNative(const std::string& msg);
+  virtual void HandleBinaryMessageFromNative(const void* data, size_t size);
+  virtual void HandleAsyncReplyFromNative(int32_t request_id,
+                                          const std::string& reply);
+
+  void CallMessageListener(v8::Handle<v8::Value> message);
+
+  // Resolves the promise of |request_id| without running its reactions.
+  void ResolveAsyncReply(int32_t request_id, const std::string& reply);
+  // Resolves the replies given while JavaScript was running.
+  static void ResolveDeferredRepliesJob(void* data);
+
+  // Delivers the messages queued for a batching listener as one array.
+  static void FlushMessagesJob(void* data);
+  void FlushMessages();
 
   // Callbacks for JS functions available in 'extension' object.
   static void PostMessageCallback(
       const v8::FunctionCallbackInfo<v8::Value>& info);
   static void SendSyncMessageCallback(
       const v8::FunctionCallbackInfo<v8::Value>& info);
+  static void SendAsyncMessageCallback(
+      const v8::FunctionCallbackInfo<v8::Value>& info);
   static void SetMessageListenerCallback(
       const v8::FunctionCallbackInfo<v8::Value>& info);
   static void SendRuntimeMessageCallback(
@@ -56,20 +76,43 @@ class XWalkExtensionModule : public XWalkExtensionClient::InstanceHandler {
   static void SendRuntimeAsyncMessageCallback(
       const v8::FunctionCallbackInfo<v8::Value>& info);
 
+  // Template for the 'extension' objects exposed to the extension JS code,
+  // created once per isolate. The functions find their module from the
+  // object they are called on, so they have to be called as its methods.
+  static v8::Handle<v8::FunctionTemplate> GetExtensionTemplate(
+      v8::Isolate* isolate);
+
+  // Returns the module of the 'extension' object the function is called on.
+  // Returns NULL, with a TypeError thrown, if it isn't called on such an
+  // object, and NULL if the module is already destroyed.
   static XWalkExtensionModule* GetExtensionModule(
       const v8::FunctionCallbackInfo<v8::Value>& info);
 
-  // Template for the 'extension' object exposed to the extension JS code.
-  v8::Persistent<v8::ObjectTemplate> object_template_;
-
-  // This JS object contains a pointer back to the ExtensionModule, it is
-  // set as data for the function callbacks.
-  v8::Persistent<v8::Object> function_data_;
+  // The 'extension' object, which contains a pointer back to the
+  // ExtensionModule in an internal field.
+  v8::Persistent<v8::Object> extension_object_;
 
   // Function to be called when the extension sends a message to its JS code.
   // This value is registered by using 'extension.setMessageListener()'.
   v8::Persistent<v8::Function> message_listener_;
 
+  // If the listener is set with 'extension.setMessageListener(listener,
+  // {batch: true})', the messages posted in one main loop iteration are
+  // passed to it at once as an array.
+  bool batch_messages_;
+  std::vector<std::string> pending_messages_;
+  Ecore_Job* flush_job_;
+
+  // Promises returned by 'extension.sendAsyncMessage()' which wait for the
+  // reply of the extension, by the request id.
+  std::map<int32_t, v8::Persistent<v8::Promise::Resolver>*> pending_replies_;
+  int32_t next_request_id_;
+  // Replies given while JavaScript is on the stack, e.g. by an extension
+  // replying inside its message handler. They are resolved from the main
+  // loop, where the reactions of the promises can run.
+  std::vector<std::pair<int32_t, std::string>> deferred_replies_;
+  Ecore_Job* reply_job_;
+
   std::string extension_name_;
 
   XWalkExtensionClient* client_;
@@ -6,12 +6,15 @@
 #include "extensions/renderer/xwalk_extension_renderer_controller.h"
 
 #include <v8/v8.h>
+#include <set>
 #include <string>
 #include <utility>
 
 #include "common/logger.h"
 #include "common/profiler.h"
+#include "extensions/common/xwalk_extension_adapter.h"
 #include "extensions/renderer/object_tools_module.h"
+#include "extensions/renderer/runtime_ipc_client.h"
 #include "extensions/renderer/widget_module.h"
 #include "extensions/renderer/xwalk_extension_client.h"
 #include "extensions/renderer/xwalk_extension_module.h"
@@ -22,6 +25,16 @@ namespace extensions {
 
 namespace {
 
+// Index of the embedder data which holds the copy of Object made for the
+// objecttools module while a deferred context waits for its extensions. It
+// is false once they are installed or the context is released. Index chosen
+// to not conflict with the module system, the routing id and
+// WebCore::V8ContextEmbedderDataField in V8PerContextData.h.
+const int kDeferredEmbedderDataIndex = 9;
+
+// Answered by the runtime with the runtime variables as a JSON object.
+const char kGetRuntimeVariablesMessageType[] = "tizen://getRuntimeVariables";
+
 void CreateExtensionModules(XWalkExtensionClient* client,
                             XWalkModuleSystem* module_system) {
   SCOPE_PROFILE();
@@ -30,11 +43,31 @@ void CreateExtensionModules(XWalkExtensionClient* client,
   for (auto it = extensions.begin(); it != extensions.end(); ++it) {
     std::unique_ptr<XWalkExtensionModule> module(
         new XWalkExtensionModule(client, module_system, it->first));
-    module_system->RegisterExtensionModule(
-        std::move(module), it->second->entry_points());
+    module_system->RegisterExtensionModule(std::move(module), it->second);
   }
 }
 
+// The extensions are installed in the deferred context when one of their
+// namespaces is first touched, from this context or from another frame.
+void DeferredNamespaceGetter(
+    v8::Local<v8::String> property,
+    const v8::PropertyCallbackInfo<v8::Value>& info) {
+  v8::Handle<v8::Context> context = info.Holder()->CreationContext();
+  XWalkExtensionRendererController::GetInstance().InstallDeferredScriptContext(
+      context);
+  info.GetReturnValue().Set(context->Global()->Get(property));
+}
+
+void DeferredNamespaceSetter(
+    v8::Local<v8::String> property,
+    v8::Local<v8::Value> value,
+    const v8::PropertyCallbackInfo<void>& info) {
+  v8::Handle<v8::Context> context = info.Holder()->CreationContext();
+  XWalkExtensionRendererController::GetInstance().InstallDeferredScriptContext(
+      context);
+  context->Global()->Set(property, value);
+}
+
 }  // namespace
 
 XWalkExtensionRendererController&
@@ -44,7 +77,8 @@ XWalkExtensionRendererController::GetInstance() {
 }
 
 XWalkExtensionRendererController::XWalkExtensionRendererController()
-    : extensions_client_(new XWalkExtensionClient()) {
+    : extensions_client_(new XWalkExtensionClient()),
+      has_runtime_variables_(false) {
 }
 
 XWalkExtensionRendererController::~XWalkExtensionRendererController() {
@@ -52,6 +86,13 @@ XWalkExtensionRendererController::~XWalkExtensionRendererController() {
 
 void XWalkExtensionRendererController::DidCreateScriptContext(
     v8::Handle<v8::Context> context) {
+  v8::HandleScope handle_scope(context->GetIsolate());
+  v8::Context::Scope context_scope(context);
+  InstallModuleSystem(context, ObjectToolsModule::CreateObject());
+}
+
+void XWalkExtensionRendererController::InstallModuleSystem(
+    v8::Handle<v8::Context> context, v8::Handle<v8::Object> object_tools) {
   SCOPE_PROFILE();
   XWalkModuleSystem* module_system = new XWalkModuleSystem(context);
   XWalkModuleSystem::SetModuleSystemInContext(
@@ -65,20 +106,123 @@ void XWalkExtensionRendererController::DidCreateScriptContext(
         std::unique_ptr<XWalkNativeModule>(new WidgetModule));
   module_system->RegisterNativeModule(
         "objecttools",
-        std::unique_ptr<XWalkNativeModule>(new ObjectToolsModule));
+        std::unique_ptr<XWalkNativeModule>(
+            new ObjectToolsModule(object_tools)));
 
   CreateExtensionModules(extensions_client_.get(), module_system);
   module_system->Initialize();
 }
 
+void XWalkExtensionRendererController::DeferScriptContext(
+    v8::Handle<v8::Context> context) {
+  SCOPE_PROFILE();
+  v8::Isolate* isolate = context->GetIsolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::Context::Scope context_scope(context);
+  // The scripts of the page haven't run yet, so Object is still the
+  // original one.
+  v8::Handle<v8::Object> object_tools = ObjectToolsModule::CreateObject();
+  if (object_tools.IsEmpty())
+    object_tools = v8::Object::New(isolate);
+  context->SetEmbedderData(kDeferredEmbedderDataIndex, object_tools);
+  v8::Handle<v8::Object> global = context->Global();
+  const std::vector<std::string>& namespaces = GetDeferredNamespaces();
+  for (auto it = namespaces.begin(); it != namespaces.end(); ++it) {
+    global->SetAccessor(v8::String::NewFromUtf8(isolate, it->c_str()),
+                        DeferredNamespaceGetter, DeferredNamespaceSetter);
+  }
+}
+
+void XWalkExtensionRendererController::InstallDeferredScriptContext(
+    v8::Handle<v8::Context> context) {
+  // The accessors may still be touched through the global of a released
+  // context, e.g. from another frame, which must not get a module system
+  // again. The embedder data is cleared first, as the installation touches
+  // them too.
+  v8::Isolate* isolate = context->GetIsolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::Local<v8::Value> object_tools =
+      context->GetEmbedderData(kDeferredEmbedderDataIndex);
+  if (!object_tools->IsObject())
+    return;
+  context->SetEmbedderData(kDeferredEmbedderDataIndex, v8::False(isolate));
+
+  v8::Context::Scope context_scope(context);
+  v8::Handle<v8::Object> global = context->Global();
+  const std::vector<std::string>& namespaces = GetDeferredNamespaces();
+  for (auto it = namespaces.begin(); it != namespaces.end(); ++it) {
+    global->Delete(v8::String::NewFromUtf8(isolate, it->c_str()));
+  }
+
+  InstallModuleSystem(context, v8::Handle<v8::Object>::Cast(object_tools));
+}
+
+const std::vector<std::string>&
+XWalkExtensionRendererController::GetDeferredNamespaces() {
+  if (deferred_namespaces_.empty()) {
+    // The top level names of the extensions and their entry points.
+    std::set<std::string> names;
+    auto extensions = extensions_client_->GetExtensions();
+    for (auto it = extensions.begin(); it != extensions.end(); ++it) {
+      names.insert(it->first.substr(0, it->first.find('.')));
+      auto entry_it = it->second.begin();
+      for (; entry_it != it->second.end(); ++entry_it) {
+        names.insert(entry_it->substr(0, entry_it->find('.')));
+      }
+    }
+    deferred_namespaces_.assign(names.begin(), names.end());
+  }
+  return deferred_namespaces_;
+}
+
 void XWalkExtensionRendererController::WillReleaseScriptContext(
     v8::Handle<v8::Context> context) {
+  v8::HandleScope handle_scope(context->GetIsolate());
   v8::Context::Scope contextScope(context);
+  context->SetEmbedderData(kDeferredEmbedderDataIndex,
+                           v8::False(context->GetIsolate()));
   XWalkModuleSystem::ResetModuleSystemFromContext(context);
+  extensions_client_->DumpMetrics();
+}
+
+void XWalkExtensionRendererController::InitializeExtensions(
+    const std::string& app_id) {
+  XWalkExtensionAdapter::GetInstance()->AttachMessageLoop();
+  extensions_client_->Initialize(app_id);
+}
+
+void XWalkExtensionRendererController::Shutdown() {
+  XWalkExtensionAdapter::GetInstance()->DetachMessageLoop();
+}
+
+void XWalkExtensionRendererController::PreloadExtensions() {
+  extensions_client_->PreloadExtensions();
 }
 
-void XWalkExtensionRendererController::InitializeExtensions() {
-  extensions_client_->Initialize();
+void XWalkExtensionRendererController::OnLowMemory() {
+  extensions_client_->OnLowMemory();
+}
+
+void XWalkExtensionRendererController::DumpMetrics() {
+  extensions_client_->DumpMetrics();
+}
+
+void XWalkExtensionRendererController::SetRuntimeVariables(
+    const std::string& variables) {
+  has_runtime_variables_ = true;
+  extensions_client_->SetRuntimeVariables(variables);
+}
+
+void XWalkExtensionRendererController::FetchRuntimeVariables(
+    v8::Handle<v8::Context> context) {
+  // The runtime may have pushed them before this renderer started.
+  if (has_runtime_variables_)
+    return;
+  std::string variables = RuntimeIPCClient::GetInstance()->SendSyncMessage(
+      context, kGetRuntimeVariablesMessageType, "");
+  if (!variables.empty()) {
+    SetRuntimeVariables(variables);
+  }
 }
 
 }  // namespace extensions
@@ -9,6 +9,7 @@
 #include <v8/v8.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace extensions {
 
@@ -21,14 +22,36 @@ class XWalkExtensionRendererController {
   void DidCreateScriptContext(v8::Handle<v8::Context> context);
   void WillReleaseScriptContext(v8::Handle<v8::Context> context);
 
-  void InitializeExtensions();
+  // Defers the module system of |context| until one of the namespaces of the
+  // extensions is touched in it.
+  void DeferScriptContext(v8::Handle<v8::Context> context);
+  void InstallDeferredScriptContext(v8::Handle<v8::Context> context);
+
+  void InitializeExtensions(const std::string& app_id);
+  // Called when the renderer shuts down, while ecore is still running.
+  void Shutdown();
+  void PreloadExtensions();
+  void OnLowMemory();
+  void DumpMetrics();
+  void SetRuntimeVariables(const std::string& variables);
+  // Fetches the runtime variables from the runtime through |context|, unless
+  // they have been received already.
+  void FetchRuntimeVariables(v8::Handle<v8::Context> context);
 
  private:
   XWalkExtensionRendererController();
   virtual ~XWalkExtensionRendererController();
 
+  // Creates the module system of |context|, whose objecttools module uses
+  // |object_tools| made by ObjectToolsModule::CreateObject().
+  void InstallModuleSystem(v8::Handle<v8::Context> context,
+                           v8::Handle<v8::Object> object_tools);
+  const std::vector<std::string>& GetDeferredNamespaces();
+
  private:
   std::unique_ptr<XWalkExtensionClient> extensions_client_;
+  std::vector<std::string> deferred_namespaces_;
+  bool has_runtime_variables_;
 };
 
 }  // namespace extensions
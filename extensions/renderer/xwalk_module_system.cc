@@ -8,6 +8,7 @@
 #include <v8/v8.h>
 
 #include <algorithm>
+#include <map>
 
 #include "common/logger.h"
 #include "extensions/renderer/xwalk_extension_module.h"
@@ -21,28 +22,23 @@ namespace {
 // WebCore::V8ContextEmbedderDataField in V8PerContextData.h.
 const int kModuleSystemEmbedderDataIndex = 8;
 
-// This is the key used in the data object passed to our callbacks to store a
-// pointer back to XWalkExtensionModule.
-const char* kXWalkModuleSystem = "kXWalkModuleSystem";
-
 void RequireNativeCallback(const v8::FunctionCallbackInfo<v8::Value>& info) {
   v8::ReturnValue<v8::Value> result(info.GetReturnValue());
 
   v8::Isolate* isolate = info.GetIsolate();
   v8::HandleScope handle_scope(isolate);
 
-  v8::Handle<v8::Object> data = info.Data().As<v8::Object>();
-  v8::Handle<v8::Value> module_system_value =
-      data->Get(v8::String::NewFromUtf8(isolate, kXWalkModuleSystem));
-  if (module_system_value.IsEmpty() || module_system_value->IsUndefined()) {
+  // The function is shared by all the module systems of the isolate, and is
+  // called in the context of the module system which it was given to.
+  XWalkModuleSystem* module_system =
+      XWalkModuleSystem::GetModuleSystemFromContext(
+          isolate->GetCurrentContext());
+  if (!module_system) {
     LOGGER(ERROR) << "Trying to use requireNative from already "
                   << "destroyed module system!";
     return;
   }
 
-  XWalkModuleSystem* module_system = static_cast<XWalkModuleSystem*>(
-      module_system_value.As<v8::External>()->Value());
-
   if (info.Length() < 1) {
     // TODO(cmarcelo): Throw appropriate exception or warning.
     result.SetUndefined();
@@ -58,21 +54,25 @@ void RequireNativeCallback(const v8::FunctionCallbackInfo<v8::Value>& info) {
   result.Set(object);
 }
 
+// Returns the requireNative() function of the current context. Its template
+// is created once per isolate.
+v8::Handle<v8::Function> GetRequireNativeFunction(v8::Isolate* isolate) {
+  static std::map<v8::Isolate*, v8::Eternal<v8::FunctionTemplate>> templates;
+  v8::EscapableHandleScope handle_scope(isolate);
+  v8::Eternal<v8::FunctionTemplate>& eternal = templates[isolate];
+  if (eternal.IsEmpty()) {
+    eternal.Set(isolate,
+                v8::FunctionTemplate::New(isolate, RequireNativeCallback));
+  }
+  return handle_scope.Escape(eternal.Get(isolate)->GetFunction());
+}
+
 }  // namespace
 
-XWalkModuleSystem::XWalkModuleSystem(v8::Handle<v8::Context> context) {
+XWalkModuleSystem::XWalkModuleSystem(v8::Handle<v8::Context> context)
+    : trampoline_tree_(NULL) {
   v8::Isolate* isolate = context->GetIsolate();
   v8_context_.Reset(isolate, context);
-
-  v8::HandleScope handle_scope(isolate);
-  v8::Handle<v8::Object> function_data = v8::Object::New(isolate);
-  function_data->Set(v8::String::NewFromUtf8(isolate, kXWalkModuleSystem),
-                     v8::External::New(isolate, this));
-  v8::Handle<v8::FunctionTemplate> require_native_template =
-      v8::FunctionTemplate::New(isolate, RequireNativeCallback, function_data);
-
-  function_data_.Reset(isolate, function_data);
-  require_native_template_.Reset(isolate, require_native_template);
 }
 
 XWalkModuleSystem::~XWalkModuleSystem() {
@@ -86,8 +86,6 @@ XWalkModuleSystem::~XWalkModuleSystem() {
   v8::Isolate* isolate = v8::Isolate::GetCurrent();
   v8::HandleScope handle_scope(isolate);
 
-  require_native_template_.Reset();
-  function_data_.Reset();
   v8_context_.Reset();
 }
 
@@ -154,35 +152,6 @@ void XWalkModuleSystem::RegisterNativeModule(
 
 namespace {
 
-v8::Handle<v8::Value> EnsureTargetObjectForTrampoline(
-    v8::Handle<v8::Context> context, const std::vector<std::string>& path,
-    std::string* error) {
-  v8::Handle<v8::Object> object = context->Global();
-  v8::Isolate* isolate = context->GetIsolate();
-
-  std::vector<std::string>::const_iterator it = path.begin();
-  for (; it != path.end(); ++it) {
-    v8::Handle<v8::String> part =
-        v8::String::NewFromUtf8(isolate, it->c_str());
-    v8::Handle<v8::Value> value = object->Get(part);
-
-    if (value->IsUndefined()) {
-      v8::Handle<v8::Object> next_object = v8::Object::New(isolate);
-      object->Set(part, next_object);
-      object = next_object;
-      continue;
-    }
-
-    if (!value->IsObject()) {
-      *error = "the property '" + *it + "' in the path is undefined";
-      return v8::Undefined(isolate);
-    }
-
-    object = value.As<v8::Object>();
-  }
-  return object;
-}
-
 v8::Handle<v8::Value> GetObjectForPath(v8::Handle<v8::Context> context,
                                        const std::vector<std::string>& path,
                                        std::string* error) {
@@ -223,38 +192,6 @@ void SplitString(const STR& str, const typename STR::value_type s,
   }
 }
 
-bool XWalkModuleSystem::SetTrampolineAccessorForEntryPoint(
-    v8::Handle<v8::Context> context,
-    const std::string& entry_point,
-    v8::Local<v8::External> user_data) {
-  std::vector<std::string> path;
-  SplitString(entry_point, '.', &path);
-  std::string basename = path.back();
-  path.pop_back();
-
-  std::string error;
-  v8::Handle<v8::Value> value =
-      EnsureTargetObjectForTrampoline(context, path, &error);
-  if (value->IsUndefined()) {
-    LOGGER(ERROR) << "Error installing trampoline for " << entry_point
-                  << " : " << error;
-    return false;
-  }
-
-  v8::Isolate* isolate = context->GetIsolate();
-  v8::Local<v8::Array> params = v8::Array::New(isolate);
-  v8::Local<v8::String> entry =
-      v8::String::NewFromUtf8(isolate, entry_point.c_str());
-  params->Set(v8::Integer::New(isolate, 0), user_data);
-  params->Set(v8::Integer::New(isolate, 1), entry);
-
-  // FIXME(cmarcelo): ensure that trampoline is readonly.
-  value.As<v8::Object>()->SetAccessor(
-      v8::String::NewFromUtf8(isolate, basename.c_str()),
-      TrampolineCallback, TrampolineSetterCallback, params);
-  return true;
-}
-
 // static
 bool XWalkModuleSystem::DeleteAccessorForEntryPoint(
     v8::Handle<v8::Context> context,
@@ -277,27 +214,149 @@ bool XWalkModuleSystem::DeleteAccessorForEntryPoint(
   return true;
 }
 
-bool XWalkModuleSystem::InstallTrampoline(v8::Handle<v8::Context> context,
-                                     ExtensionModuleEntry* entry) {
-  v8::Local<v8::External> entry_ptr =
-      v8::External::New(context->GetIsolate(), entry);
-  bool ret = SetTrampolineAccessorForEntryPoint(context, entry->name,
-                                                entry_ptr);
-  if (!ret) {
-    LOGGER(ERROR) << "Error installing trampoline for " << entry->name;
-    return false;
+// A node of the namespace tree of the entry points with trampolines. It is
+// either a trampoline, whose accessor loads the extension, or a namespace
+// object which holds other nodes.
+struct XWalkModuleSystem::TrampolineNode {
+  TrampolineNode(const std::string& name, int index)
+      : name(name), index(index) {}
+
+  TrampolineNode* GetChild(const std::string& child_name) {
+    for (auto it = children.begin(); it != children.end(); ++it) {
+      if ((*it)->name == child_name)
+        return it->get();
+    }
+    return NULL;
   }
 
-  auto it = entry->entry_points.begin();
-  for (; it != entry->entry_points.end(); ++it) {
-    ret = SetTrampolineAccessorForEntryPoint(context, *it, entry_ptr);
-    if (!ret) {
-      // TODO(vcgomes): Remove already added trampolines when it fails.
-      LOGGER(ERROR) << "Error installing trampoline for " << entry->name;
-      return false;
+  // Appends the indexes of the trampolines at and below the node.
+  void CollectIndexes(std::vector<size_t>* indexes) const {
+    if (index >= 0)
+      indexes->push_back(static_cast<size_t>(index));
+    for (auto it = children.begin(); it != children.end(); ++it)
+      (*it)->CollectIndexes(indexes);
+  }
+
+  std::string name;
+  // Index of the entry point of a trampoline, or -1 for a namespace.
+  int index;
+  std::vector<std::unique_ptr<TrampolineNode>> children;
+
+  v8::Persistent<v8::String> v8_name;
+  // Template of a namespace object, with the trampolines and the namespaces
+  // below it.
+  v8::Persistent<v8::ObjectTemplate> object_template;
+};
+
+struct XWalkModuleSystem::TrampolineTree {
+  TrampolineTree() : root("", -1) {}
+
+  std::vector<std::string> entry_points;
+  // Indexes of the entry points without trampolines, as their paths conflict
+  // with other entry points.
+  std::vector<size_t> conflicts;
+  TrampolineNode root;
+};
+
+// static
+const XWalkModuleSystem::TrampolineTree* XWalkModuleSystem::GetTrampolineTree(
+    v8::Isolate* isolate, const std::vector<std::string>& entry_points) {
+  // The contexts of a renderer have the same extensions, so there is one tree
+  // per isolate in practice. The trees live as long as the process.
+  static std::map<v8::Isolate*,
+                  std::map<std::vector<std::string>, TrampolineTree*>> trees;
+  TrampolineTree*& tree = trees[isolate][entry_points];
+  if (tree)
+    return tree;
+
+  tree = new TrampolineTree;
+  tree->entry_points = entry_points;
+  for (size_t i = 0; i < entry_points.size(); ++i) {
+    std::vector<std::string> path;
+    SplitString(entry_points[i], '.', &path);
+    std::string basename = path.back();
+    path.pop_back();
+
+    TrampolineNode* node = &tree->root;
+    auto it = path.begin();
+    for (; it != path.end() && node->index < 0; ++it) {
+      TrampolineNode* child = node->GetChild(*it);
+      if (!child) {
+        child = new TrampolineNode(*it, -1);
+        node->children.push_back(std::unique_ptr<TrampolineNode>(child));
+      }
+      node = child;
+    }
+    if (node->index >= 0 || node->GetChild(basename)) {
+      LOGGER(ERROR) << "Error installing trampoline for " << entry_points[i]
+                    << " : the path conflicts with another entry point";
+      tree->conflicts.push_back(i);
+      continue;
+    }
+    node->children.push_back(std::unique_ptr<TrampolineNode>(
+        new TrampolineNode(basename, static_cast<int>(i))));
+  }
+
+  v8::HandleScope handle_scope(isolate);
+  BuildTrampolineTemplate(isolate, &tree->root);
+  return tree;
+}
+
+// static
+void XWalkModuleSystem::BuildTrampolineTemplate(v8::Isolate* isolate,
+                                                TrampolineNode* node) {
+  v8::Handle<v8::ObjectTemplate> object_template =
+      v8::ObjectTemplate::New(isolate);
+  auto it = node->children.begin();
+  for (; it != node->children.end(); ++it) {
+    TrampolineNode* child = it->get();
+    v8::Handle<v8::String> name =
+        v8::String::NewFromUtf8(isolate, child->name.c_str());
+    child->v8_name.Reset(isolate, name);
+    if (child->index >= 0) {
+      // FIXME(cmarcelo): ensure that trampoline is readonly.
+      object_template->SetAccessor(name, TrampolineCallback,
+                                   TrampolineSetterCallback,
+                                   v8::Integer::New(isolate, child->index));
+    } else {
+      BuildTrampolineTemplate(isolate, child);
+      object_template->Set(name, v8::Local<v8::ObjectTemplate>::New(
+          isolate, child->object_template));
+    }
+  }
+  node->object_template.Reset(isolate, object_template);
+}
+
+// static
+void XWalkModuleSystem::InstallTrampolines(v8::Isolate* isolate,
+                                           v8::Handle<v8::Object> object,
+                                           const TrampolineNode* node,
+                                           std::vector<size_t>* failed) {
+  auto it = node->children.begin();
+  for (; it != node->children.end(); ++it) {
+    const TrampolineNode* child = it->get();
+    v8::Handle<v8::String> name =
+        v8::Local<v8::String>::New(isolate, child->v8_name);
+    if (child->index >= 0) {
+      // FIXME(cmarcelo): ensure that trampoline is readonly.
+      object->SetAccessor(name, TrampolineCallback, TrampolineSetterCallback,
+                          v8::Integer::New(isolate, child->index));
+      continue;
+    }
+
+    v8::Handle<v8::Value> value = object->Get(name);
+    if (value->IsUndefined()) {
+      // The whole namespace is created at once from its template.
+      object->Set(name, v8::Local<v8::ObjectTemplate>::New(
+          isolate, child->object_template)->NewInstance());
+    } else if (value->IsObject()) {
+      InstallTrampolines(isolate, value.As<v8::Object>(), child, failed);
+    } else {
+      LOGGER(ERROR) << "Error installing trampolines in " << child->name
+                    << " : the property is not an object";
+      child->CollectIndexes(failed);
     }
   }
-  return true;
 }
 
 v8::Handle<v8::Object> XWalkModuleSystem::RequireNative(
@@ -312,20 +371,54 @@ void XWalkModuleSystem::Initialize() {
   v8::Isolate* isolate = v8::Isolate::GetCurrent();
   v8::HandleScope handle_scope(isolate);
   v8::Handle<v8::Context> context = GetV8Context();
-  v8::Handle<v8::FunctionTemplate> require_native_template =
-      v8::Local<v8::FunctionTemplate>::New(isolate, require_native_template_);
-  v8::Handle<v8::Function> require_native =
-      require_native_template->GetFunction();
+  v8::Handle<v8::Function> require_native = GetRequireNativeFunction(isolate);
 
   MarkModulesWithTrampoline();
 
+  // The extensions without trampolines are loaded first, as they may create
+  // the namespaces which the trampolines are installed in.
+  std::vector<std::string> entry_points;
   auto it = extension_modules_.begin();
   for (; it != extension_modules_.end(); ++it) {
-    if (it->use_trampoline && InstallTrampoline(context, &*it))
+    if (it->use_trampoline) {
+      trampolines_.push_back(&*it);
+      entry_points.push_back(it->name);
+      auto entry_it = it->entry_points.begin();
+      for (; entry_it != it->entry_points.end(); ++entry_it) {
+        trampolines_.push_back(&*it);
+        entry_points.push_back(*entry_it);
+      }
       continue;
+    }
     it->module->LoadExtensionCode(context, require_native);
     EnsureExtensionNamespaceIsReadOnly(context, it->name);
   }
+
+  if (trampolines_.empty())
+    return;
+  trampoline_tree_ = GetTrampolineTree(isolate, entry_points);
+  std::vector<size_t> failed(trampoline_tree_->conflicts);
+  InstallTrampolines(isolate, context->Global(), &trampoline_tree_->root,
+                     &failed);
+
+  // The extensions missing some of their trampolines are loaded now instead,
+  // after removing the trampolines they have.
+  for (auto failed_it = failed.begin(); failed_it != failed.end();
+       ++failed_it) {
+    ExtensionModuleEntry* entry = trampolines_[*failed_it];
+    if (!entry)
+      continue;
+    for (size_t i = 0; i < trampolines_.size(); ++i) {
+      if (trampolines_[i] != entry)
+        continue;
+      trampolines_[i] = NULL;
+      if (std::find(failed.begin(), failed.end(), i) == failed.end())
+        DeleteAccessorForEntryPoint(context, entry_points[i]);
+    }
+    entry->use_trampoline = false;
+    entry->module->LoadExtensionCode(context, require_native);
+    EnsureExtensionNamespaceIsReadOnly(context, entry->name);
+  }
 }
 
 v8::Handle<v8::Context> XWalkModuleSystem::GetV8Context() {
@@ -354,22 +447,30 @@ void XWalkModuleSystem::DeleteExtensionModules() {
     delete it->module;
   }
   extension_modules_.clear();
+  trampolines_.clear();
 }
 
 // static
 void XWalkModuleSystem::LoadExtensionForTrampoline(
     v8::Isolate* isolate,
     v8::Local<v8::Value> data) {
-  v8::Local<v8::Array> params = data.As<v8::Array>();
-  void* ptr = params->Get(
-      v8::Integer::New(isolate, 0)).As<v8::External>()->Value();
+  v8::Handle<v8::Context> context = isolate->GetCurrentContext();
+  XWalkModuleSystem* module_system = GetModuleSystemFromContext(context);
+  if (!module_system)
+    return;
 
-  ExtensionModuleEntry* entry = static_cast<ExtensionModuleEntry*>(ptr);
+  size_t index = data->Uint32Value();
+  if (index >= module_system->trampolines_.size())
+    return;
+  ExtensionModuleEntry* entry = module_system->trampolines_[index];
 
   if (!entry)
     return;
 
-  v8::Handle<v8::Context> context = isolate->GetCurrentContext();
+  // The other trampolines of the extension are disabled as well.
+  std::replace(module_system->trampolines_.begin(),
+               module_system->trampolines_.end(), entry,
+               static_cast<ExtensionModuleEntry*>(NULL));
 
   DeleteAccessorForEntryPoint(context, entry->name);
 
@@ -378,16 +479,9 @@ void XWalkModuleSystem::LoadExtensionForTrampoline(
     DeleteAccessorForEntryPoint(context, *it);
   }
 
-  XWalkModuleSystem* module_system = GetModuleSystemFromContext(context);
-  v8::Handle<v8::FunctionTemplate> require_native_template =
-      v8::Local<v8::FunctionTemplate>::New(
-          isolate,
-          module_system->require_native_template_);
-
-
   XWalkExtensionModule* module = entry->module;
   module->LoadExtensionCode(module_system->GetV8Context(),
-                            require_native_template->GetFunction());
+                            GetRequireNativeFunction(isolate));
 
   module_system->EnsureExtensionNamespaceIsReadOnly(context, entry->name);
 }
@@ -396,16 +490,20 @@ void XWalkModuleSystem::LoadExtensionForTrampoline(
 v8::Handle<v8::Value> XWalkModuleSystem::RefetchHolder(
     v8::Isolate* isolate,
     v8::Local<v8::Value> data) {
-  v8::Local<v8::Array> params = data.As<v8::Array>();
-  const std::string entry_point = *v8::String::Utf8Value(
-      params->Get(v8::Integer::New(isolate, 1)).As<v8::String>());
+  v8::Handle<v8::Context> context = isolate->GetCurrentContext();
+  XWalkModuleSystem* module_system = GetModuleSystemFromContext(context);
+  size_t index = data->Uint32Value();
+  if (!module_system || !module_system->trampoline_tree_ ||
+      index >= module_system->trampoline_tree_->entry_points.size())
+    return v8::Undefined(isolate);
 
   std::vector<std::string> path;
-  SplitString(entry_point, '.', &path);
+  SplitString(module_system->trampoline_tree_->entry_points[index], '.',
+              &path);
   path.pop_back();
 
   std::string error;
-  return GetObjectForPath(isolate->GetCurrentContext(), path, &error);
+  return GetObjectForPath(context, path, &error);
 }
 
 // static
@@ -65,16 +65,25 @@ class XWalkModuleSystem {
                          const ExtensionModuleEntry& second);
   };
 
-  bool SetTrampolineAccessorForEntryPoint(
-      v8::Handle<v8::Context> context,
-      const std::string& entry_point,
-      v8::Local<v8::External> user_data);
-
   static bool DeleteAccessorForEntryPoint(v8::Handle<v8::Context> context,
                                           const std::string& entry_point);
 
-  bool InstallTrampoline(v8::Handle<v8::Context> context,
-                         ExtensionModuleEntry* entry);
+  // The trampolines of all the contexts are built once per isolate, as a
+  // tree of object templates. Their accessors refer to the extension by the
+  // index of the entry point.
+  struct TrampolineNode;
+  struct TrampolineTree;
+
+  static const TrampolineTree* GetTrampolineTree(
+      v8::Isolate* isolate, const std::vector<std::string>& entry_points);
+  static void BuildTrampolineTemplate(v8::Isolate* isolate,
+                                      TrampolineNode* node);
+  // Appends to |failed| the indexes of the trampolines which can't be
+  // installed, as a namespace on their path is not an object.
+  static void InstallTrampolines(v8::Isolate* isolate,
+                                 v8::Handle<v8::Object> object,
+                                 const TrampolineNode* node,
+                                 std::vector<size_t>* failed);
 
   static void TrampolineCallback(
       v8::Local<v8::String> property,
@@ -102,8 +111,10 @@ class XWalkModuleSystem {
   typedef std::map<std::string, XWalkNativeModule*> NativeModuleMap;
   NativeModuleMap native_modules_;
 
-  v8::Persistent<v8::FunctionTemplate> require_native_template_;
-  v8::Persistent<v8::Object> function_data_;
+  // The extensions of the trampolines by the index of their entry points.
+  // The entries are cleared when the extension is loaded.
+  std::vector<ExtensionModuleEntry*> trampolines_;
+  const TrampolineTree* trampoline_tree_;
 
   // Points back to the current context, used when native wants to callback
   // JavaScript. When WillReleaseScriptContext() is called, we dispose this
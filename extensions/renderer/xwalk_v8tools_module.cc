@@ -38,7 +38,10 @@ void LifecycleTrackerCleanup(
     return;
   }
 
-  v8::Handle<v8::Context> context = v8::Context::New(isolate);
+  // The destructor is called on the global object of the context which
+  // created the tracker.
+  v8::Handle<v8::Context> context = tracker->CreationContext();
+  v8::Context::Scope context_scope(context);
 
   v8::TryCatch try_catch;
   v8::Handle<v8::Function>::Cast(function)->Call(context->Global(), 0, NULL);
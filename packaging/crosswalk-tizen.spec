@@ -3,6 +3,7 @@
 
 %define extension_path %{_libdir}/tizen-extensions-crosswalk
 %define injected_bundle_path %{_libdir}/libxwalk_injected_bundle.so
+%define extension_host_path %{_bindir}/xwalk_extension
 
 Name:       crosswalk-tizen
 Summary:    Crosswalk Runtime and AppShell for Tizen
@@ -33,6 +34,7 @@ BuildRequires: pkgconfig(ecore-wayland)
 BuildRequires: pkgconfig(efl-extension)
 BuildRequires: pkgconfig(elementary)
 BuildRequires: pkgconfig(gio-2.0)
+BuildRequires: pkgconfig(gio-unix-2.0)
 BuildRequires: pkgconfig(glib-2.0)
 BuildRequires: pkgconfig(libwebappenc)
 BuildRequires: pkgconfig(wgt-manifest-handlers)
@@ -66,6 +68,7 @@ GYP_OPTIONS="$GYP_OPTIONS -Dextension_path=%{extension_path}"
 
 # Injected bundle
 GYP_OPTIONS="$GYP_OPTIONS -Dinjected_bundle_path=%{injected_bundle_path}"
+GYP_OPTIONS="$GYP_OPTIONS -Dextension_host_path=%{extension_host_path}"
 
 # Build
 ./tools/gyp/gyp $GYP_OPTIONS xwalk_tizen.gyp
@@ -109,6 +112,9 @@ install -p -m 644 out/Default/gen/*.edj %{buildroot}%{_datadir}/edje/xwalk
 # xwalk_injected_bundle
 install -p -m 755 out/Default/lib/libxwalk_injected_bundle.so %{buildroot}%{_libdir}
 
+# xwalk_extension
+install -p -m 755 out/Default/xwalk_extension %{buildroot}%{_bindir}
+
 %clean
 rm -fr %{buildroot}
 
@@ -125,3 +131,4 @@ rm -fr %{buildroot}
 %attr(644,root,root) %{extension_path}/splash_screen.json
 %attr(755,root,root) %{_bindir}/xwalk_runtime
 %attr(755,root,root) %{_bindir}/wrt
+%attr(755,root,root) %{_bindir}/xwalk_extension
@@ -17,22 +17,37 @@
 #include "runtime/browser/runtime.h"
 
 #include <ewk_chromium.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <future>
 #include <memory>
 #include <string>
 
 #include "common/application_data.h"
 #include "common/app_control.h"
-#include "common/app_db.h"
-#include "common/command_line.h"
 #include "common/logger.h"
 #include "common/profiler.h"
 #include "runtime/browser/native_app_window.h"
 #include "runtime/common/constants.h"
 
+#ifndef EXTENSION_HOST_PATH
+#error EXTENSION_HOST_PATH is not set.
+#endif
+
 namespace runtime {
 
 namespace {
 
+// The time to wait for the socket of the extension host before the renderer
+// is started, in milliseconds.
+const int kExtensionHostReadyTimeout = 1000;
+
 static NativeWindow* CreateNativeWindow() {
   SCOPE_PROFILE();
   // TODO(wy80.choi) : consider other type of native window.
@@ -43,9 +58,12 @@ static NativeWindow* CreateNativeWindow() {
 
 }  // namespace
 
-Runtime::Runtime()
+Runtime::Runtime(ApplicationDataFuture appdata)
     : application_(NULL),
-      native_window_(NULL) {
+      native_window_(NULL),
+      appdata_(std::move(appdata)),
+      extension_host_pid_(0),
+      extension_host_ready_fd_(-1) {
 }
 
 Runtime::~Runtime() {
@@ -55,6 +73,67 @@ Runtime::~Runtime() {
   if (native_window_) {
     delete native_window_;
   }
+  if (extension_host_ready_fd_ >= 0) {
+    close(extension_host_ready_fd_);
+  }
+  if (extension_host_pid_ > 0) {
+    kill(extension_host_pid_, SIGTERM);
+    waitpid(extension_host_pid_, NULL, 0);
+  }
+}
+
+void Runtime::LaunchExtensionHost(const std::string& appid) {
+  if (getenv(kExtensionHostEnableKey) == NULL) {
+    return;
+  }
+
+  SCOPE_PROFILE();
+  // The extension host closes the write end of the pipe when its socket is
+  // ready, or when it exits.
+  int ready_pipe[2];
+  if (pipe2(ready_pipe, O_CLOEXEC) != 0) {
+    ready_pipe[0] = ready_pipe[1] = -1;
+  }
+  // Nothing may allocate in the child, so the arguments are built here.
+  std::string ready_fd = std::to_string(ready_pipe[1]);
+  pid_t pid = fork();
+  if (pid < 0) {
+    LOGGER(ERROR) << "Failed to fork the extension host.";
+    if (ready_pipe[0] >= 0) {
+      close(ready_pipe[0]);
+      close(ready_pipe[1]);
+    }
+    return;
+  }
+  if (pid == 0) {
+    // The extension host doesn't outlive the runtime.
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (ready_pipe[1] >= 0) {
+      fcntl(ready_pipe[1], F_SETFD, 0);
+    }
+    execl(EXTENSION_HOST_PATH, EXTENSION_HOST_PATH, appid.c_str(),
+          ready_fd.c_str(), NULL);
+    _exit(EXIT_FAILURE);
+  }
+  extension_host_pid_ = pid;
+  if (ready_pipe[0] >= 0) {
+    close(ready_pipe[1]);
+    extension_host_ready_fd_ = ready_pipe[0];
+  }
+}
+
+void Runtime::WaitForExtensionHost() {
+  if (extension_host_ready_fd_ < 0) {
+    return;
+  }
+
+  SCOPE_PROFILE();
+  struct pollfd ready = { extension_host_ready_fd_, POLLIN, 0 };
+  if (poll(&ready, 1, kExtensionHostReadyTimeout) <= 0) {
+    LOGGER(WARN) << "Extension host is not ready in time.";
+  }
+  close(extension_host_ready_fd_);
+  extension_host_ready_fd_ = -1;
 }
 
 bool Runtime::OnCreate() {
@@ -62,21 +141,18 @@ bool Runtime::OnCreate() {
   STEP_PROFILE_END("Start -> OnCreate");
   STEP_PROFILE_START("OnCreate -> URL Set");
 
-  common::CommandLine* cmd = common::CommandLine::ForCurrentProcess();
-  std::string appid = cmd->GetAppIdFromCommandLine(kRuntimeExecName);
-
-  // Load Manifest
-  std::unique_ptr<common::ApplicationData>
-      appdata(new common::ApplicationData(appid));
-  if (!appdata->LoadManifestData()) {
+  // Wait for the manifest which has been loading since main()
+  STEP_PROFILE_START("Wait for Manifest");
+  std::unique_ptr<common::ApplicationData> appdata = appdata_.get();
+  STEP_PROFILE_END("Wait for Manifest");
+  if (!appdata) {
     return false;
   }
+  std::string appid = appdata->app_id();
 
-  // Init AppDB for Runtime
-  common::AppDB* appdb = common::AppDB::GetInstance();
-  appdb->Set(kAppDBRuntimeSection, kAppDBRuntimeName, "xwalk-tizen");
-  appdb->Set(kAppDBRuntimeSection, kAppDBRuntimeAppID, appid);
-  appdb->Remove(kAppDBRuntimeSection, kAppDBRuntimeBundle);
+  // The extension host loads the extensions while the window and the
+  // renderer are being created.
+  LaunchExtensionHost(appid);
 
   // Init WebApplication
   native_window_ = CreateNativeWindow();
@@ -110,12 +186,11 @@ void Runtime::OnAppControl(app_control_h app_control) {
   SCOPE_PROFILE();
   std::unique_ptr<common::AppControl>
       appcontrol(new common::AppControl(app_control));
-  common::AppDB* appdb = common::AppDB::GetInstance();
-  appdb->Set(kAppDBRuntimeSection, kAppDBRuntimeBundle,
-             appcontrol->encoded_bundle());
   if (application_->launched()) {
     application_->AppControl(std::move(appcontrol));
   } else {
+    // The renderer connects to the extension host when it starts.
+    WaitForExtensionHost();
     application_->Launch(std::move(appcontrol));
   }
 }
@@ -133,6 +208,20 @@ void Runtime::OnLowMemory() {
   }
 }
 
+// static
+Runtime::ApplicationDataFuture Runtime::LoadManifestAsync(
+    const std::string& appid) {
+  return std::async(std::launch::async,
+                    [appid]() -> std::unique_ptr<common::ApplicationData> {
+    std::unique_ptr<common::ApplicationData>
+        appdata(new common::ApplicationData(appid));
+    if (!appdata->LoadManifestData()) {
+      appdata.reset();
+    }
+    return appdata;
+  });
+}
+
 int Runtime::Exec(int argc, char* argv[]) {
   ui_app_lifecycle_callback_s ops = {NULL, NULL, NULL, NULL, NULL};
 
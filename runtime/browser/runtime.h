@@ -18,20 +18,34 @@
 #define XWALK_RUNTIME_BROWSER_RUNTIME_H_
 
 #include <app.h>
+#include <sys/types.h>
+#include <future>
+#include <memory>
 #include <string>
 
 #include "runtime/browser/native_window.h"
 #include "runtime/browser/web_application.h"
 
+namespace common {
+class ApplicationData;
+}  // namespace common
+
 namespace runtime {
 
 class Runtime {
  public:
-  Runtime();
+  typedef std::future<std::unique_ptr<common::ApplicationData>>
+      ApplicationDataFuture;
+
+  explicit Runtime(ApplicationDataFuture appdata);
   virtual ~Runtime();
 
   virtual int Exec(int argc, char* argv[]);
 
+  // Loads the manifest of the given app on a worker thread. The result is
+  // NULL if the manifest couldn't be loaded.
+  static ApplicationDataFuture LoadManifestAsync(const std::string& appid);
+
  protected:
   virtual bool OnCreate();
   virtual void OnTerminate();
@@ -42,8 +56,18 @@ class Runtime {
   virtual void OnLowMemory();
 
  private:
+  // Launches the shared extension host process of the application, if it is
+  // enabled with the environment variable.
+  void LaunchExtensionHost(const std::string& appid);
+  // Waits until the extension host serves its socket, so the renderer can
+  // connect to it at once.
+  void WaitForExtensionHost();
+
   WebApplication* application_;
   NativeWindow* native_window_;
+  ApplicationDataFuture appdata_;
+  pid_t extension_host_pid_;
+  int extension_host_ready_fd_;
 };
 
 }  // namespace runtime
@@ -16,10 +16,13 @@
 
 #include <ewk_chromium.h>
 
+#include <utility>
+
 #include "common/command_line.h"
 #include "common/logger.h"
 #include "common/profiler.h"
 #include "runtime/browser/runtime.h"
+#include "runtime/common/constants.h"
 
 int main(int argc, char* argv[]) {
   STEP_PROFILE_START("Start -> Launch Completed");
@@ -27,6 +30,14 @@ int main(int argc, char* argv[]) {
   // Parse commandline.
   common::CommandLine::Init(argc, argv);
 
+  // Start loading the manifest as soon as the app id is known, so that the
+  // package manager lookups and the config.xml parsing overlap with the
+  // Chromium and EFL initialization.
+  common::CommandLine* cmd = common::CommandLine::ForCurrentProcess();
+  runtime::Runtime::ApplicationDataFuture appdata =
+      runtime::Runtime::LoadManifestAsync(
+          cmd->GetAppIdFromCommandLine(runtime::kRuntimeExecName));
+
   // Default behavior, run as runtime.
   LOGGER(INFO) << "Runtime process has been created.";
   ewk_init();
@@ -44,7 +55,7 @@ int main(int argc, char* argv[]) {
   int ret = 0;
   // Runtime's destructor should be called before ewk_shutdown()
   {
-    runtime::Runtime runtime;
+    runtime::Runtime runtime(std::move(appdata));
     ret = runtime.Exec(argc, argv);
   }
   ewk_shutdown();
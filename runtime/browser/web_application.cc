@@ -20,6 +20,8 @@
 #include <Ecore.h>
 #include <ewk_chromium.h>
 
+#include <stdlib.h>
+
 #include <algorithm>
 #include <map>
 #include <memory>
@@ -29,9 +31,12 @@
 #include "common/application_data.h"
 #include "common/app_db.h"
 #include "common/app_control.h"
+#include "common/app_policy.h"
 #include "common/command_line.h"
+#include "common/constants.h"
 #include "common/locale_manager.h"
 #include "common/logger.h"
+#include "common/picojson.h"
 #include "common/profiler.h"
 #include "common/resource_manager.h"
 #include "common/string_utils.h"
@@ -42,6 +47,7 @@
 #include "runtime/browser/vibration_manager.h"
 #include "runtime/browser/web_view.h"
 #include "runtime/browser/splash_screen.h"
+#include "runtime/common/constants.h"
 
 #ifndef INJECTED_BUNDLE_PATH
 #error INJECTED_BUNDLE_PATH is not set.
@@ -58,6 +64,7 @@ const char* kConsoleLogEnableKey = "WRT_CONSOLE_LOG_ENABLE";
 const char* kConsoleMessageLogTag = "ConsoleMessage";
 
 const char* kDebugKey = "debug";
+const char* kExtensionMetricsKey = "extension_metrics";
 const char* kPortKey = "port";
 
 const char* kAppControlEventScript =
@@ -89,23 +96,8 @@ const char* kMenuKeyEventScript =
     "for (var i=0; i < window.frames.length; i++)\n"
     "{ window.frames[i].document.dispatchEvent(__event); }"
     "})()";
-const char* kFullscreenPrivilege = "http://tizen.org/privilege/fullscreen";
-const char* kFullscreenFeature = "fullscreen";
-const char* kNotificationPrivilege = "http://tizen.org/privilege/notification";
-const char* kLocationPrivilege = "http://tizen.org/privilege/location";
-const char* kStoragePrivilege = "http://tizen.org/privilege/unlimitedstorage";
-const char* kUsermediaPrivilege = "http://tizen.org/privilege/mediacapture";
 const char* kNotiIconFile = "noti_icon.png";
 
-const char* kVisibilitySuspendFeature = "visibility,suspend";
-const char* kMediastreamRecordFeature = "mediastream,record";
-const char* kEncryptedDatabaseFeature = "encrypted,database";
-const char* kRotationLockFeature = "rotation,lock";
-const char* kBackgroundMusicFeature = "background,music";
-const char* kSoundModeFeature = "sound,mode";
-const char* kBackgroundVibrationFeature = "background,vibration";
-const char* kCSPFeature = "csp";
-
 const char* kGeolocationPermissionPrefix = "__WRT_GEOPERM_";
 const char* kNotificationPermissionPrefix = "__WRT_NOTIPERM_";
 const char* kQuotaPermissionPrefix = "__WRT_QUOTAPERM_";
@@ -113,19 +105,14 @@ const char* kCertificateAllowPrefix = "__WRT_CERTIPERM_";
 const char* kUsermediaPermissionPrefix = "__WRT_USERMEDIAPERM_";
 const char* kDBPrivateSection = "private";
 
-const char* kDefaultCSPRule =
-    "default-src *; script-src 'self'; style-src 'self'; object-src 'none';";
-
-bool FindPrivilege(common::ApplicationData* app_data,
-                   const std::string& privilege) {
-  if (app_data->permissions_info().get() == NULL) return false;
-  auto it = app_data->permissions_info()->GetAPIPermissions().begin();
-  auto end = app_data->permissions_info()->GetAPIPermissions().end();
-  for (; it != end; ++it) {
-    if (*it == privilege) return true;
-  }
-  return false;
-}
+// Notifies the extensions in the renderer of the memory pressure.
+const char* kLowMemoryMessageType = "tizen://lowMemory";
+// Carries the runtime variables of the extensions to the renderer.
+const char* kRuntimeVariablesMessageType = "tizen://runtimeVariables";
+// Sent by the renderer to fetch the runtime variables when it starts.
+const char* kGetRuntimeVariablesMessageType = "tizen://getRuntimeVariables";
+// Asks the renderer to write the metrics of the extensions.
+const char* kExtensionMetricsMessageType = "tizen://dumpExtensionMetrics";
 
 static void SendDownloadRequest(const std::string& url) {
   common::AppControl request;
@@ -212,6 +199,7 @@ WebApplication::WebApplication(
       appid_(app_data->app_id()),
       locale_manager_(new common::LocaleManager()),
       app_data_(std::move(app_data)),
+      policy_(app_data_->policy()),
       terminator_(NULL) {
   std::unique_ptr<char, decltype(std::free)*> path{app_get_data_path(),
                                                    std::free};
@@ -262,49 +250,19 @@ bool WebApplication::Initialize() {
                                               this);
   InitializeNotificationCallback(ewk_context_, this);
 
-  if (FindPrivilege(app_data_.get(), kFullscreenPrivilege)) {
-    ewk_context_tizen_extensible_api_string_set(ewk_context_,
-                                                kFullscreenFeature, true);
-  }
-
-  if (app_data_->setting_info() != NULL &&
-      app_data_->setting_info()->background_support_enabled()) {
-    ewk_context_tizen_extensible_api_string_set(
-        ewk_context_, kVisibilitySuspendFeature, true);
-    ewk_context_tizen_extensible_api_string_set(ewk_context_,
-                                                kBackgroundMusicFeature, true);
-  }
-  ewk_context_tizen_extensible_api_string_set(ewk_context_,
-                                              kMediastreamRecordFeature, true);
-  ewk_context_tizen_extensible_api_string_set(ewk_context_,
-                                              kEncryptedDatabaseFeature, true);
-  if (app_data_->setting_info() != NULL &&
-      app_data_->setting_info()->screen_orientation() ==
-          wgt::parse::SettingInfo::ScreenOrientation::AUTO) {
-    ewk_context_tizen_extensible_api_string_set(ewk_context_,
-                                                kRotationLockFeature, true);
-  } else if (app_data_->setting_info() != NULL &&
-             app_data_->setting_info()->screen_orientation() ==
-                 wgt::parse::SettingInfo::ScreenOrientation::PORTRAIT) {
-    window_->SetRotationLock(NativeWindow::ScreenOrientation::PORTRAIT_PRIMARY);
-  } else if (app_data_->setting_info() != NULL &&
-             app_data_->setting_info()->screen_orientation() ==
-                 wgt::parse::SettingInfo::ScreenOrientation::LANDSCAPE) {
-    window_->SetRotationLock(
-        NativeWindow::ScreenOrientation::LANDSCAPE_PRIMARY);
-  }
-
-  if (app_data_->setting_info() != NULL &&
-      app_data_->setting_info()->sound_mode() ==
-          wgt::parse::SettingInfo::SoundMode::EXCLUSIVE) {
-    ewk_context_tizen_extensible_api_string_set(ewk_context_, kSoundModeFeature,
+  const auto& features = policy_->extensible_api_features();
+  for (auto it = features.begin(); it != features.end(); ++it) {
+    ewk_context_tizen_extensible_api_string_set(ewk_context_, it->c_str(),
                                                 true);
   }
 
-  if (app_data_->setting_info() != NULL &&
-      app_data_->setting_info()->background_vibration()) {
-    ewk_context_tizen_extensible_api_string_set(
-        ewk_context_, kBackgroundVibrationFeature, true);
+  if (policy_->screen_orientation() ==
+      common::AppPolicy::ScreenOrientation::PORTRAIT) {
+    window_->SetRotationLock(NativeWindow::ScreenOrientation::PORTRAIT_PRIMARY);
+  } else if (policy_->screen_orientation() ==
+             common::AppPolicy::ScreenOrientation::LANDSCAPE) {
+    window_->SetRotationLock(
+        NativeWindow::ScreenOrientation::LANDSCAPE_PRIMARY);
   }
 
   if (app_data_->widget_info() != NULL &&
@@ -319,25 +277,6 @@ bool WebApplication::Initialize() {
   // TODO(sngn.lee): find the proxy url
   // ewk_context_proxy_uri_set(ewk_context_, ... );
 
-  if (app_data_->csp_info() != NULL || app_data_->csp_report_info() != NULL ||
-      app_data_->allowed_navigation_info() != NULL) {
-    security_model_version_ = 2;
-    if (app_data_->csp_info() == NULL ||
-        app_data_->csp_info()->security_rules().empty()) {
-      csp_rule_ = kDefaultCSPRule;
-    } else {
-      csp_rule_ = app_data_->csp_info()->security_rules();
-    }
-    if (app_data_->csp_report_info() != NULL &&
-        !app_data_->csp_report_info()->security_rules().empty()) {
-      csp_report_rule_ = app_data_->csp_report_info()->security_rules();
-    }
-    ewk_context_tizen_extensible_api_string_set(ewk_context_, kCSPFeature,
-                                                EINA_TRUE);
-  } else {
-    security_model_version_ = 1;
-  }
-
   return true;
 }
 
@@ -348,6 +287,7 @@ void WebApplication::Launch(std::unique_ptr<common::AppControl> appcontrol) {
 
   // send widget info to injected bundle
   ewk_context_tizen_app_id_set(ewk_context_, appid_.c_str());
+  SendRuntimeVariables(appcontrol.get());
 
   std::unique_ptr<common::ResourceManager::Resource> res =
       resource_manager_->GetStartResource(appcontrol.get());
@@ -376,6 +316,9 @@ void WebApplication::Launch(std::unique_ptr<common::AppControl> appcontrol) {
 
 void WebApplication::AppControl(
     std::unique_ptr<common::AppControl> appcontrol) {
+  // The page reads the new bundle from its appcontrol event handler.
+  SendRuntimeVariables(appcontrol.get());
+
   std::unique_ptr<common::ResourceManager::Resource> res =
       resource_manager_->GetStartResource(appcontrol.get());
 
@@ -406,9 +349,52 @@ void WebApplication::AppControl(
     debug_mode_ = true;
     LaunchInspector(appcontrol.get());
   }
+  if (appcontrol->data(kExtensionMetricsKey) == "true") {
+    RequestExtensionMetrics();
+  }
   window_->Active();
 }
 
+void WebApplication::RequestExtensionMetrics() {
+  Ewk_IPC_Wrt_Message_Data* msg = ewk_ipc_wrt_message_data_new();
+  ewk_ipc_wrt_message_data_type_set(msg, kExtensionMetricsMessageType);
+  if (!ewk_ipc_wrt_message_send(ewk_context_, msg)) {
+    LOGGER(ERROR) << "Failed to send extension metrics message";
+  }
+  ewk_ipc_wrt_message_data_del(msg);
+}
+
+void WebApplication::SendRuntimeVariables(common::AppControl* appcontrol) {
+  SCOPE_PROFILE();
+  picojson::object variables;
+  variables[common::kAppDBRuntimeName] = picojson::value(common::kRuntimeName);
+  variables[common::kAppDBRuntimeAppID] = picojson::value(appid_);
+  variables[common::kAppDBRuntimeBundle] =
+      picojson::value(appcontrol->encoded_bundle());
+
+  // The renderer fetches them if it starts after this message is sent.
+  runtime_variables_ = picojson::value(variables).serialize();
+
+  Ewk_IPC_Wrt_Message_Data* msg = ewk_ipc_wrt_message_data_new();
+  ewk_ipc_wrt_message_data_type_set(msg, kRuntimeVariablesMessageType);
+  ewk_ipc_wrt_message_data_value_set(msg, runtime_variables_.c_str());
+  if (!ewk_ipc_wrt_message_send(ewk_context_, msg)) {
+    LOGGER(ERROR) << "Failed to send runtime variables";
+  }
+  ewk_ipc_wrt_message_data_del(msg);
+
+  // The extension host doesn't receive the message, so its extensions
+  // still read the variables from the AppDB.
+  if (getenv(common::kRuntimeVariableAppDBEnableKey) != NULL ||
+      getenv(kExtensionHostEnableKey) != NULL) {
+    auto db = common::AppDB::GetInstance();
+    for (auto it = variables.begin(); it != variables.end(); ++it) {
+      db->Set(common::kAppDBRuntimeSection, it->first,
+              it->second.get<std::string>());
+    }
+  }
+}
+
 void WebApplication::SendAppControlEvent() {
   if (view_stack_.size() > 0 && view_stack_.front() != NULL)
     view_stack_.front()->EvalJavascript(kAppControlEventScript);
@@ -432,8 +418,7 @@ void WebApplication::Resume() {
   if (view_stack_.size() > 0 && view_stack_.front() != NULL)
     view_stack_.front()->SetVisibility(true);
 
-  if (app_data_->setting_info() != NULL &&
-      app_data_->setting_info()->background_support_enabled()) {
+  if (policy_->background_support_enabled()) {
     return;
   }
 
@@ -447,8 +432,7 @@ void WebApplication::Suspend() {
   if (view_stack_.size() > 0 && view_stack_.front() != NULL)
     view_stack_.front()->SetVisibility(false);
 
-  if (app_data_->setting_info() != NULL &&
-      app_data_->setting_info()->background_support_enabled()) {
+  if (policy_->background_support_enabled()) {
     LOGGER(DEBUG) << "gone background (backgroud support enabed)";
     return;
   }
@@ -557,6 +541,9 @@ void WebApplication::OnReceivedWrtMessage(WebView* /*view*/,
     ewk_ipc_wrt_message_data_del(ans);
   } else if (TYPE_IS("tizen://hide_splash_screen")) {
     splash_screen_->HideSplashScreen(SplashScreen::HideReason::CUSTOM);
+  } else if (TYPE_IS(kGetRuntimeVariablesMessageType)) {
+    // Sync Message
+    ewk_ipc_wrt_message_data_value_set(msg, runtime_variables_.c_str());
   }
 
 
@@ -576,13 +563,8 @@ void WebApplication::OnOrientationLock(
   // Only top-most view can set the orientation relate operation
   if (view_stack_.front() != view) return;
 
-  auto orientaion_setting =
-      app_data_->setting_info() != NULL
-          ? app_data_->setting_info()->screen_orientation()
-          :
-          // TODO(sngn.lee): check default value
-          wgt::parse::SettingInfo::ScreenOrientation::AUTO;
-  if (orientaion_setting != wgt::parse::SettingInfo::ScreenOrientation::AUTO) {
+  if (policy_->screen_orientation() !=
+      common::AppPolicy::ScreenOrientation::AUTO) {
     return;
   }
 
@@ -594,15 +576,12 @@ void WebApplication::OnOrientationLock(
 }
 
 void WebApplication::OnHardwareKey(WebView* view, const std::string& keyname) {
-  bool enabled = app_data_->setting_info() != NULL
-                     ? app_data_->setting_info()->hwkey_enabled()
-                     : true;
+  bool enabled = policy_->hwkey_enabled();
   if (enabled && kKeyNameBack == keyname) {
     view->EvalJavascript(kBackKeyEventScript);
     // NOTE: This code is added for backward compatibility.
     // If the 'backbutton_presence' is true, WebView should be navigated back.
-    if (app_data_->setting_info() &&
-        app_data_->setting_info()->backbutton_presence()) {
+    if (policy_->backbutton_presence()) {
       view->Backward();
     }
   } else if (enabled && kKeyNameMenu == keyname) {
@@ -643,12 +622,17 @@ void WebApplication::OnConsoleMessage(const std::string& msg, int level) {
 void WebApplication::OnLowMemory() {
   ewk_context_cache_clear(ewk_context_);
   ewk_context_notify_low_memory(ewk_context_);
+
+  Ewk_IPC_Wrt_Message_Data* msg = ewk_ipc_wrt_message_data_new();
+  ewk_ipc_wrt_message_data_type_set(msg, kLowMemoryMessageType);
+  if (!ewk_ipc_wrt_message_send(ewk_context_, msg)) {
+    LOGGER(ERROR) << "Failed to send low memory message";
+  }
+  ewk_ipc_wrt_message_data_del(msg);
 }
 
 bool WebApplication::OnContextMenuDisabled(WebView* /*view*/) {
-  return !(app_data_->setting_info() != NULL
-               ? app_data_->setting_info()->context_menu_enabled()
-               : true);
+  return !policy_->context_menu_enabled();
 }
 
 void WebApplication::OnLoadStart(WebView* /*view*/) {
@@ -680,10 +664,10 @@ void WebApplication::SetupWebView(WebView* view) {
   view->SetEventListener(this);
 
   // Setup CSP Rule
-  if (security_model_version_ == 2) {
-    view->SetCSPRule(csp_rule_, false);
-    if (!csp_report_rule_.empty()) {
-      view->SetCSPRule(csp_report_rule_, true);
+  if (policy_->security_model_version() == 2) {
+    view->SetCSPRule(policy_->csp_rule(), false);
+    if (!policy_->csp_report_rule().empty()) {
+      view->SetCSPRule(policy_->csp_report_rule(), true);
     }
   }
 
@@ -717,7 +701,7 @@ void WebApplication::OnNotificationPermissionRequest(
   // Local Domain: Grant permission if defined, otherwise Popup user prompt.
   // Remote Domain: Popup user prompt.
   if (common::utils::StartsWith(url, "file://") &&
-      FindPrivilege(app_data_.get(), kNotificationPrivilege)) {
+      policy_->HasPrivilege(common::AppPolicy::Privilege::NOTIFICATION)) {
     result_handler(true);
     return;
   }
@@ -757,7 +741,7 @@ void WebApplication::OnGeolocationPermissionRequest(
 
   // Local Domain: Grant permission if defined, otherwise block execution.
   // Remote Domain: Popup user prompt if defined, otherwise block execution.
-  if (!FindPrivilege(app_data_.get(), kLocationPrivilege)) {
+  if (!policy_->HasPrivilege(common::AppPolicy::Privilege::LOCATION)) {
     result_handler(false);
     return;
   }
@@ -802,7 +786,8 @@ void WebApplication::OnQuotaExceed(WebView*, const std::string& url,
   // Local Domain: Grant permission if defined, otherwise Popup user prompt.
   // Remote Domain: Popup user prompt.
   if (common::utils::StartsWith(url, "file://") &&
-      FindPrivilege(app_data_.get(), kStoragePrivilege)) {
+      policy_->HasPrivilege(
+          common::AppPolicy::Privilege::UNLIMITED_STORAGE)) {
     result_handler(true);
     return;
   }
@@ -897,7 +882,7 @@ void WebApplication::OnUsermediaPermissionRequest(
 
   // Local Domain: Grant permission if defined, otherwise block execution.
   // Remote Domain: Popup user prompt if defined, otherwise block execution.
-  if (!FindPrivilege(app_data_.get(), kUsermediaPrivilege)) {
+  if (!policy_->HasPrivilege(common::AppPolicy::Privilege::MEDIA_CAPTURE)) {
     result_handler(false);
     return;
   }
@@ -28,6 +28,7 @@ class Ewk_Context;
 
 namespace common {
 class AppControl;
+class AppPolicy;
 class ApplicationData;
 class LocaleManager;
 class ResourceManager;
@@ -94,7 +95,12 @@ class WebApplication : public WebView::EventListener {
   bool Initialize();
 
   void ClearViewStack();
+  // Pushes the runtime variables of the extensions to the renderer.
+  void SendRuntimeVariables(common::AppControl* appcontrol);
   void SendAppControlEvent();
+  // Asks the renderer to write the extension metrics, which include the
+  // ones of the extension host.
+  void RequestExtensionMetrics();
   void LaunchInspector(common::AppControl* appcontrol);
   void SetupWebView(WebView* view);
 
@@ -104,15 +110,15 @@ class WebApplication : public WebView::EventListener {
   NativeWindow* window_;
   std::string appid_;
   std::string app_data_path_;
+  // The runtime variables last sent to the renderer, as a JSON object.
+  std::string runtime_variables_;
   std::list<WebView*> view_stack_;
   std::unique_ptr<SplashScreen> splash_screen_;
   std::unique_ptr<common::LocaleManager> locale_manager_;
   std::unique_ptr<common::ApplicationData> app_data_;
+  std::shared_ptr<const common::AppPolicy> policy_;
   std::unique_ptr<common::ResourceManager> resource_manager_;
   std::function<void(void)> terminator_;
-  int security_model_version_;
-  std::string csp_rule_;
-  std::string csp_report_rule_;
 };
 
 }  // namespace runtime
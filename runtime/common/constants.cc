@@ -20,12 +20,11 @@ namespace runtime {
 
 const char kRuntimeExecName[] = "xwalk_runtime";
 
-const char kAppDBRuntimeSection[] = "Runtime";
-const char kAppDBRuntimeAppID[] = "app_id";
-const char kAppDBRuntimeName[] = "runtime_name";
-const char kAppDBRuntimeBundle[] = "encoded_bundle";
-
 const char kTextLocalePath[] = "/usr/share/locale";
 const char kTextDomainRuntime[] = "xwalk";
 
+// Must be the same as extensions::kExtensionHostEnableKey, which the renderer
+// checks to connect to the extension host.
+const char kExtensionHostEnableKey[] = "WRT_EXTENSION_HOST_ENABLE";
+
 }  // namespace runtime
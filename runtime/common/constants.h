@@ -21,14 +21,11 @@ namespace runtime {
 
 extern const char kRuntimeExecName[];
 
-extern const char kAppDBRuntimeSection[];
-extern const char kAppDBRuntimeAppID[];
-extern const char kAppDBRuntimeName[];
-extern const char kAppDBRuntimeBundle[];
-
 extern const char kTextLocalePath[];
 extern const char kTextDomainRuntime[];
 
+extern const char kExtensionHostEnableKey[];
+
 }  // namespace runtime
 
 #endif  // XWALK_RUNTIME_COMMON_CONSTANTS_H_
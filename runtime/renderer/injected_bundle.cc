@@ -16,6 +16,7 @@
 
 #include <Ecore.h>
 #include <ewk_chromium.h>
+#include <string.h>
 #include <unistd.h>
 #include <v8.h>
 
@@ -28,11 +29,24 @@
 #include "common/profiler.h"
 #include "common/resource_manager.h"
 #include "common/string_utils.h"
+#include "extensions/common/xwalk_extension_privileges.h"
 #include "extensions/renderer/runtime_ipc_client.h"
 #include "extensions/renderer/widget_module.h"
+#include "extensions/renderer/xwalk_extension_injection_policy.h"
 #include "extensions/renderer/xwalk_extension_renderer_controller.h"
 #include "extensions/renderer/xwalk_module_system.h"
 
+namespace {
+
+// Sent by the runtime when the system is low on memory.
+const char kLowMemoryMessageType[] = "tizen://lowMemory";
+// Sent by the runtime on launch and app control with the runtime variables.
+const char kRuntimeVariablesMessageType[] = "tizen://runtimeVariables";
+// Sent by the runtime to write the extension metrics.
+const char kExtensionMetricsMessageType[] = "tizen://dumpExtensionMetrics";
+
+}  // namespace
+
 namespace runtime {
 class BundleGlobalData {
  public :
@@ -58,6 +72,11 @@ class BundleGlobalData {
     auto widgetdb = extensions::WidgetPreferenceDB::GetInstance();
     widgetdb->Initialize(app_data_.get(),
                          locale_manager_.get());
+
+    extensions::XWalkExtensionPrivileges::GetInstance()->Initialize(
+        app_data_.get());
+    extensions::XWalkExtensionInjectionPolicy::GetInstance()->Initialize(
+        app_data_.get());
   }
 
   common::ResourceManager* resource_manager() {
@@ -82,7 +101,8 @@ extern "C" void DynamicSetWidgetInfo(const char* tizen_id) {
   STEP_PROFILE_START("Initialize XWalkExtensionRendererController");
   extensions::XWalkExtensionRendererController& controller =
       extensions::XWalkExtensionRendererController::GetInstance();
-  controller.InitializeExtensions();
+  controller.InitializeExtensions(tizen_id);
+  controller.PreloadExtensions();
   STEP_PROFILE_END("Initialize XWalkExtensionRendererController");
 }
 
@@ -114,6 +134,13 @@ extern "C" void DynamicPluginStartSession(const char* tizen_id,
 
   extensions::XWalkExtensionRendererController& controller =
       extensions::XWalkExtensionRendererController::GetInstance();
+  controller.FetchRuntimeVariables(context);
+  if (extensions::XWalkExtensionInjectionPolicy::GetInstance()->ShouldDefer(
+          context, base_url)) {
+    LOGGER(DEBUG) << "Extensions are deferred in " << base_url;
+    controller.DeferScriptContext(context);
+    return;
+  }
   controller.DidCreateScriptContext(context);
 }
 
@@ -154,12 +181,42 @@ extern "C" void DynamicUrlParsing(
   }
 }
 
-extern "C" void DynamicDatabaseAttach(int /*attach*/) {
+extern "C" void DynamicDatabaseAttach(int attach) {
   // LOGGER(DEBUG) << "InjectedBundle::DynamicDatabaseAttach !!";
+  // The database is detached when the renderer shuts down.
+  if (!attach) {
+    extensions::XWalkExtensionRendererController& controller =
+        extensions::XWalkExtensionRendererController::GetInstance();
+    controller.Shutdown();
+  }
 }
 
 extern "C" void DynamicOnIPCMessage(const Ewk_IPC_Wrt_Message_Data& data) {
   LOGGER(DEBUG) << "InjectedBundle::DynamicOnIPCMessage !!";
+  Eina_Stringshare* msg_type = ewk_ipc_wrt_message_data_type_get(&data);
+  bool low_memory = msg_type && !strcmp(msg_type, kLowMemoryMessageType);
+  bool runtime_variables =
+      msg_type && !strcmp(msg_type, kRuntimeVariablesMessageType);
+  bool extension_metrics =
+      msg_type && !strcmp(msg_type, kExtensionMetricsMessageType);
+  eina_stringshare_del(msg_type);
+  extensions::XWalkExtensionRendererController& controller =
+      extensions::XWalkExtensionRendererController::GetInstance();
+  if (low_memory) {
+    controller.OnLowMemory();
+    return;
+  }
+  if (extension_metrics) {
+    controller.DumpMetrics();
+    return;
+  }
+  if (runtime_variables) {
+    Eina_Stringshare* msg_value = ewk_ipc_wrt_message_data_value_get(&data);
+    controller.SetRuntimeVariables(msg_value ? msg_value : "");
+    eina_stringshare_del(msg_value);
+    return;
+  }
+
   extensions::RuntimeIPCClient* rc =
       extensions::RuntimeIPCClient::GetInstance();
   rc->HandleMessageFromRuntime(&data);
@@ -5,21 +5,265 @@
 # Use of this source code is governed by a BSD-style license that can be
 # found in the LICENSE file.
 
+import optparse
 import os
 import sys
 import subprocess
 
 TEMPLATE = """\
 extern const char %s[];
-const char %s[] = { %s, 0 };
+const char %s[] = %s;
 """
 
-js_code = sys.argv[1]
-cmd = "python " + os.path.dirname(__file__) + "/mergejs.py -f" + js_code
-lines = subprocess.check_output(cmd, shell=True)
-c_code = ', '.join(str(ord(c)) for c in lines)
+# Must be the same as WrapAPICode() in
+# extensions/renderer/xwalk_extension_module.cc, which doesn't wrap the code
+# again if it begins with the same prefix.
+WRAPPER_TEMPLATE = (
+    "var %s; (function(extension, requireNative) { "
+    "extension.internal = {};"
+    "extension.internal.sendSyncMessage ="
+    " extension.sendSyncMessage.bind(extension);"
+    "delete extension.sendSyncMessage;"
+    "extension.postMessage ="
+    " extension.postMessage.bind(extension);"
+    "extension.sendAsyncMessage ="
+    " extension.sendAsyncMessage.bind(extension);"
+    "extension.setMessageListener ="
+    " extension.setMessageListener.bind(extension);"
+    "extension.sendRuntimeMessage ="
+    " extension.sendRuntimeMessage.bind(extension);"
+    "extension.sendRuntimeSyncMessage ="
+    " extension.sendRuntimeSyncMessage.bind(extension);"
+    "extension.sendRuntimeAsyncMessage ="
+    " extension.sendRuntimeAsyncMessage.bind(extension);"
+    "var Object = requireNative('objecttools');"
+    "var exports = {}; (function() {'use strict'; %s\n})();"
+    "%s = exports; });")
 
-symbol_name = sys.argv[2]
-output = open(sys.argv[3], "w")
-output.write(TEMPLATE % (symbol_name, symbol_name, c_code))
-output.close()
+# A '/' after these punctuators begins a regular expression, not a division.
+REGEXP_PRECEDERS = '(,=:[!&|?{};+-*%<>~^'
+
+# A '/' after these keywords begins a regular expression too.
+REGEXP_KEYWORDS = frozenset([
+    'case', 'delete', 'do', 'else', 'in', 'instanceof', 'new', 'return',
+    'throw', 'typeof', 'void', 'yield'])
+
+# So does a '/' after the parenthesized head of these statements.
+CONDITION_KEYWORDS = frozenset(['for', 'if', 'while', 'with'])
+
+# Stands for the line breaks in the string and template literals while the
+# lines are stripped, so the values of the literals don't change.
+LITERAL_LINE_BREAK = '\0'
+
+
+def CodeToEnsureNamespace(extension_name):
+  result = ''
+  parts = extension_name.split('.')
+  for i in range(1, len(parts)):
+    ns = '.'.join(parts[:i])
+    result += ns + ' = ' + ns + ' || {}; '
+  return result + extension_name + ' = {};'
+
+
+def WrapAPICode(code, extension_name):
+  return WRAPPER_TEMPLATE % (CodeToEnsureNamespace(extension_name), code,
+                             extension_name)
+
+
+def IsIdentifierChar(c):
+  return c.isalnum() or c in '_$\\' or ord(c) > 127
+
+
+def StringEnd(code, i):
+  """Returns the index after the string literal beginning at code[i]."""
+  n = len(code)
+  end = i + 1
+  while end < n and code[end] != code[i]:
+    if code[end] == '\\':
+      end += 1
+    end += 1
+  return end + 1
+
+
+def RegExpEnd(code, i):
+  """Returns the index after the body of the regular expression at code[i].
+
+  The flags are scanned as an identifier.
+  """
+  n = len(code)
+  end = i + 1
+  in_class = False
+  while end < n and (code[end] != '/' or in_class):
+    if code[end] == '\\':
+      end += 1
+    elif code[end] == '[':
+      in_class = True
+    elif code[end] == ']':
+      in_class = False
+    end += 1
+  return end + 1
+
+
+def TemplateEnd(code, i):
+  """Returns the index after the template literal beginning at code[i]."""
+  n = len(code)
+  end = i + 1
+  while end < n and code[end] != '`':
+    if code[end] == '\\':
+      end += 2
+    elif code.startswith('${', end):
+      end = SubstitutionEnd(code, end + 2)
+    else:
+      end += 1
+  return end + 1
+
+
+def SubstitutionEnd(code, i):
+  """Returns the index after the '}' closing the substitution at code[i]."""
+  n = len(code)
+  depth = 1
+  while i < n and depth > 0:
+    c = code[i]
+    if c == '`':
+      i = TemplateEnd(code, i)
+      continue
+    if c in '"\'':
+      i += 1
+      while i < n and code[i] != c:
+        if code[i] == '\\':
+          i += 1
+        i += 1
+    elif c == '{':
+      depth += 1
+    elif c == '}':
+      depth -= 1
+    i += 1
+  return i
+
+
+def Minify(code):
+  """Strips the comments, the indentation and the blank lines.
+
+  The line breaks are kept, so the automatic semicolon insertion works the
+  same as in the original code. The string, template and regular expression
+  literals are kept as they are.
+  """
+  out = []
+  i = 0
+  n = len(code)
+  # The last token which is not a comment or a white space.
+  last = ''
+  # Whether a '/' here begins a regular expression rather than a division.
+  regexp_allowed = True
+  # Whether each open parenthesis is the head of a CONDITION_KEYWORDS
+  # statement.
+  parens = []
+  while i < n:
+    c = code[i]
+    if c in '"\'`':
+      end = StringEnd(code, i) if c != '`' else TemplateEnd(code, i)
+      out.append(code[i:end].replace('\n', LITERAL_LINE_BREAK))
+      i = end
+      last = c
+      regexp_allowed = False
+    elif code.startswith('//', i):
+      end = code.find('\n', i)
+      i = n if end < 0 else end
+    elif code.startswith('/*', i):
+      end = code.find('*/', i + 2)
+      if end < 0:
+        break
+      # Keeps a line break in place of the comment if it had one.
+      if '\n' in code[i:end]:
+        out.append('\n')
+      i = end + 2
+    elif c == '/' and regexp_allowed:
+      end = RegExpEnd(code, i)
+      out.append(code[i:end])
+      i = end
+      last = '/'
+      regexp_allowed = False
+    elif IsIdentifierChar(c):
+      end = i + 1
+      while end < n and IsIdentifierChar(code[end]):
+        end += 1
+      word = code[i:end]
+      # A keyword after a '.' is a property name.
+      regexp_allowed = last != '.' and word in REGEXP_KEYWORDS
+      out.append(word)
+      i = end
+      last = word if last != '.' else ''
+    elif c.isspace():
+      out.append(c)
+      i += 1
+    elif c in '+-' and code.startswith(c, i + 1):
+      # A '/' after a postfix '++' or '--' is a division.
+      out.append(c + c)
+      i += 2
+      last = c + c
+      regexp_allowed = False
+    else:
+      if c == '(':
+        parens.append(last in CONDITION_KEYWORDS)
+        regexp_allowed = True
+      elif c == ')':
+        regexp_allowed = parens.pop() if parens else False
+      else:
+        regexp_allowed = c in REGEXP_PRECEDERS
+      out.append(c)
+      i += 1
+      last = c
+
+  lines = (line.strip() for line in ''.join(out).split('\n'))
+  return '\n'.join(line for line in lines if line).replace(
+      LITERAL_LINE_BREAK, '\n')
+
+
+def ToCString(code):
+  """Returns |code| as a C string literal, split into lines."""
+  chunks = []
+  for line in code.split('\n'):
+    escaped = ''
+    for c in line:
+      if c in '\\"':
+        escaped += '\\' + c
+      elif c == '?':
+        # Avoids the trigraphs.
+        escaped += '\\?'
+      elif 32 <= ord(c) < 127:
+        escaped += c
+      else:
+        escaped += '\\%03o' % ord(c)
+    chunks.append('"%s\\n"' % escaped)
+  # The last line has no line break.
+  if chunks:
+    chunks[-1] = chunks[-1][:-3] + '"'
+  return '\n    '.join(chunks)
+
+
+def main():
+  parser = optparse.OptionParser(
+      usage='%prog <js file> <symbol name> <output file> [options]')
+  parser.add_option('--minify', type='int', default=0,
+                    help='Strip the comments and the indentation.')
+  parser.add_option('--extension-name', default='',
+                    help='Wrap the code for the extension of this name.')
+  options, args = parser.parse_args()
+  if len(args) != 3:
+    parser.error('Wrong number of arguments.')
+  js_code, symbol_name, output_path = args
+
+  cmd = "python " + os.path.dirname(__file__) + "/mergejs.py -f" + js_code
+  code = subprocess.check_output(cmd, shell=True)
+  if options.minify:
+    code = Minify(code)
+  if options.extension_name:
+    code = WrapAPICode(code, options.extension_name)
+
+  output = open(output_path, "w")
+  output.write(TEMPLATE % (symbol_name, symbol_name, ToCString(code)))
+  output.close()
+
+
+if __name__ == '__main__':
+  sys.exit(main())